@@ -0,0 +1,73 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_BENCH_BENCH_H_
+#define INCLUDE_BENCH_BENCH_H_
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// Shared pieces of the benchmarks - a timer and generated programs
+
+// Return the fastest of runs calls to work, in seconds
+template <typename Work>
+double bestSeconds(int runs, Work&& work) {
+  double best = 1e30;
+  for (int run = 0; run < runs; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    work();
+    std::chrono::duration<double> took =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, took.count());
+  }
+  return best;
+}
+// Run work on a thread with a native stack of stack bytes, and wait for it.
+// Where threads cannot be given a stack size, work runs on this thread,
+// whose stack is 1 MB on Windows
+template <typename Work>
+void runOnStack(size_t stack, Work&& work) {
+#ifdef _WIN32
+  (void)stack;
+  work();
+#else
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setstacksize(&attributes, stack);
+  pthread_t thread;
+  auto run = [](void* argument) -> void* {
+    (*static_cast<std::remove_reference_t<Work>*>(argument))();
+    return nullptr;
+  };
+  pthread_create(&thread, &attributes, run, &work);
+  pthread_join(thread, nullptr);
+  pthread_attr_destroy(&attributes);
+#endif
+}
+// Return a program of about bytes bytes made of lets, consts and functions
+// with blocks, loops, strings and indentation, as generated sources are
+inline std::string generateProgram(size_t bytes) {
+  std::string program;
+  program.reserve(bytes + 256);
+  for (size_t i = 0; program.size() < bytes; ++i) {
+    std::string n = std::to_string(i);
+    program += "let value" + n + ": int = " + n + " * (counter_" + n +
+               " + 17) - 4 / 2;\n";
+    program += "const ratio" + n + " = 3.25 + " + n + ".5;\n";
+    program += "let function" + n +
+               " = fn(first: int, second: float) -> int {\n";
+    program += "        let label = \"a longer string literal for global " +
+               n + " that the lexer has to scan to its end\";\n";
+    program += "        for index in 0..100000 {\n";
+    program += "                first = first + index;\n";
+    program += "        };\n";
+    program += "        return first;\n";
+    program += "};\n\n";
+  }
+  return program;
+}
+
+#endif  // INCLUDE_BENCH_BENCH_H_
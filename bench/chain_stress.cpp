@@ -0,0 +1,113 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+// Long operator chains - 1 + 1 + ... + 1 is parsed, resolved, type checked,
+// moved down a line by reparse() and freed on a thread with a small native
+// stack, which fails the check by crashing if any of them takes a frame per
+// operator. It also fails if an operator takes much longer in the longest
+// chain than in the shortest, as it would if a pass were not linear, unless
+// given --check, as ctest runs it. Right spines and nested parentheses are
+// run too, at the depth they are limited to
+//   chain_stress [--check]
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "bench.h"
+#include "environment.h"
+#include "expr.h"
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "stmt.h"
+#include "type_checker.h"
+#include "type_resolver.h"
+
+constexpr size_t kTerms[] = {100000, 1000000};
+// Most an operator may take in the longest chain, in times its time in the
+// shortest; a quadratic pass would take 10 times
+constexpr double kLinearSlack = 4.0;
+constexpr size_t kStack = size_t{1} << 20;
+// Right spines and nested parentheses still take a frame per level in the
+// parser and in every pass. They are only checked this deep, on the stack
+// of a main thread; -(-(...)) overflows it first, at two to three times this
+constexpr size_t kSpineDepth = 4096;
+constexpr size_t kSpineStack = size_t{8} << 20;
+struct Spine {
+  const char* name;
+  std::string_view open;
+  std::string_view close;
+  bool isInt;  // Whether the value is checked as an int
+};
+static const Spine kSpines[] = {
+    {"a = a = ...", "a = ", "", false},
+    {"((...))", "(", ")", true},
+    {"-(-(...))", "-(", ")", true},
+};
+
+// Parse, resolve and check program, then move it down a line; returns
+// whether x was moved, and checked as an int if isInt, with the parse freed
+// on this thread
+static bool checkedAndMoved(const std::string& program, bool isInt,
+                            double& seconds) {
+  Parser parser{Lexer{program}};
+  Environment* env = nullptr;
+  seconds = bestSeconds(1, [&] {
+    env = parser.parse();
+    TypeResolver{env}.resolve();
+    Resolver{env}.resolve();
+    TypeChecker{env}.visit();
+    parser.reparse(0, 0, "\n");
+    env = parser.settleLines();
+  });
+  Stmt* x = env->find(Symbol{"x"});
+  return x && x->location.line == 3 &&
+         x->getDeclarationStmt()->val->sourceLocation.line == 3 &&
+         (!isInt ||
+          x->getDeclarationStmt()->val->type == env->bottomTypes.intType);
+}
+
+int main(int argc, char* argv[]) {
+  bool checkOnly = argc == 2 && std::string_view{argv[1]} == "--check";
+  bool ok = true;
+  runOnStack(kStack, [&] {
+    double first = 0;
+    for (size_t terms : kTerms) {
+      std::string program = "let a = 1;\nlet x = 1";
+      program.reserve(program.size() + terms * 4 + 3);
+      for (size_t i = 1; i < terms; ++i) program += " + 1";
+      program += ";\n";
+      double seconds = 0;
+      if (!checkedAndMoved(program, true, seconds)) {
+        std::cout << "FAILED: the chain of " << terms
+                  << " terms was not checked and moved down a line\n";
+        ok = false;
+      }
+      double perOperator = seconds * 1e9 / static_cast<double>(terms);
+      std::cout << terms << " terms: " << seconds << " s, " << perOperator
+                << " ns per operator\n";
+      if (first == 0) first = perOperator;
+      if (!checkOnly && perOperator > first * kLinearSlack) {
+        std::cout << "FAILED: not linear in the length of the chain\n";
+        ok = false;
+      }
+    }
+  });
+  runOnStack(kSpineStack, [&] {
+    for (const Spine& spine : kSpines) {
+      std::string program = "let a = 1;\nlet x = ";
+      for (size_t i = 0; i < kSpineDepth; ++i) program += spine.open;
+      program += "1";
+      for (size_t i = 0; i < kSpineDepth; ++i) program += spine.close;
+      program += ";\n";
+      double seconds = 0;
+      if (!checkedAndMoved(program, spine.isInt, seconds)) {
+        std::cout << "FAILED: " << spine.name << " was not checked and moved "
+                  << "down a line\n";
+        ok = false;
+      }
+      std::cout << spine.name << ", " << kSpineDepth << " deep: " << seconds
+                << " s\n";
+    }
+  });
+  return ok ? 0 : 1;
+}
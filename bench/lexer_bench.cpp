@@ -0,0 +1,87 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+// Lexer throughput - MB/s of Lexer::tokenize() over a file, or over a
+// generated program, and of each byte-run scanner against the portable one
+//   lexer_bench [file.coco]
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.h"
+#include "lexer.h"
+#include "scan.h"
+#include "source_buffer.h"
+#include "token.h"
+
+constexpr int kRuns = 5;
+constexpr size_t kGeneratedBytes = 32 << 20;
+// Runs the scanners are timed on are this long, so that they reach the end
+// of every block they load
+constexpr size_t kRunBytes = 4096;
+constexpr size_t kScanBytes = 64 << 20;
+// Results are written here, so that the timed calls are not optimized out
+static volatile size_t sink = 0;
+static double megabytes(size_t bytes) {
+  return static_cast<double>(bytes) / 1e6;
+}
+// Time one scanner over runs of fill, each ended by stop
+static double scanSeconds(size_t (*kernel)(const char*, size_t), char fill,
+                          char stop) {
+  std::string text(kRunBytes, fill);
+  text.back() = stop;
+  size_t total = 0;
+  double seconds = bestSeconds(kRuns, [&] {
+    for (size_t done = 0; done < kScanBytes; done += kRunBytes) {
+      total += kernel(text.data(), text.size());
+    }
+  });
+  sink = total;
+  return seconds;
+}
+
+int main(int argc, char* argv[]) {
+  std::optional<SourceBuffer> file;
+  std::string generated;
+  std::string_view input;
+  if (argc == 2) {
+    file.emplace(argv[1]);
+    input = file->view();
+  } else {
+    generated = generateProgram(kGeneratedBytes);
+    input = generated;
+  }
+  size_t tokens = 0;
+  double seconds =
+      bestSeconds(kRuns, [&] { tokens = Lexer{input}.tokenize().size(); });
+  std::cout << "tokenize: " << megabytes(input.size()) << " MB, " << tokens
+            << " tokens, " << megabytes(input.size()) / seconds << " MB/s\n";
+
+  const ScanKernels& picked = scanKernels();
+  const ScanKernels& scalar = scalarScanKernels();
+  struct Scanner {
+    const char* name;
+    size_t (*ScanKernels::*kernel)(const char*, size_t);
+    char fill;
+    char stop;
+  };
+  const Scanner scanners[] = {
+      {"whitespace", &ScanKernels::whitespace, ' ', ';'},
+      {"identifier", &ScanKernels::identifier, 'a', ' '},
+      {"digits", &ScanKernels::digits, '7', ';'},
+      {"quote", &ScanKernels::quote, 'x', '"'},
+  };
+  std::cout << "scanners (" << picked.name << " against " << scalar.name
+            << ", MB/s):\n";
+  for (const Scanner& scanner : scanners) {
+    double vector =
+        scanSeconds(picked.*scanner.kernel, scanner.fill, scanner.stop);
+    double portable =
+        scanSeconds(scalar.*scanner.kernel, scanner.fill, scanner.stop);
+    std::cout << "  " << scanner.name << ": " << megabytes(kScanBytes) / vector
+              << " against " << megabytes(kScanBytes) / portable << ", "
+              << portable / vector << "x\n";
+  }
+  return 0;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+// Parse time of deeply nested programs, per level of nesting. Each kind of
+// nesting is parsed at several depths, and fails the check if a level takes
+// much longer at the deepest than at the shallowest, as it would if parsing
+// were not linear in the depth. With --check, as ctest runs it, each kind is
+// only parsed once at the deepest, and checked to define its global
+//   nesting_bench [--check]
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "bench.h"
+#include "environment.h"
+#include "lexer.h"
+#include "parser.h"
+
+constexpr int kRuns = 3;
+constexpr size_t kDepths[] = {8 << 10, 16 << 10, 32 << 10, 64 << 10};
+// Most a level may take at the deepest, in times its time at the shallowest;
+// quadratic parsing would take 8 times
+constexpr double kLinearSlack = 4.0;
+// Every level takes a few native frames, so the parse gets a large stack
+constexpr size_t kStack = size_t{1} << 30;
+
+static std::string repeat(std::string_view text, size_t times) {
+  std::string ans;
+  ans.reserve(text.size() * times);
+  for (size_t i = 0; i < times; ++i) ans += text;
+  return ans;
+}
+// Kinds of nesting - a global with depth of each opening around its middle
+struct Nesting {
+  const char* name;
+  std::string_view before;
+  std::string_view open;
+  std::string_view middle;
+  std::string_view close;
+  std::string_view after;
+};
+static const Nesting kNestings[] = {
+    {"parens", "let x = ", "(", "1", ")", ";\n"},
+    {"1 + (1 + (...))", "let x = ", "1 + (", "1", ")", ";\n"},
+    {"{ yield { ... } }", "let x = ", "{ yield ", "1", "; }", ";\n"},
+    {"fn() -> fn() -> ...", "let x = ", "fn() -> int ", "1", "", ";\n"},
+    {"optional[optional[...]]", "let x: ", "optional[", "int", "]", ";\n"},
+};
+
+static std::string nested(const Nesting& nesting, size_t depth) {
+  return std::string{nesting.before} + repeat(nesting.open, depth) +
+         std::string{nesting.middle} + repeat(nesting.close, depth) +
+         std::string{nesting.after};
+}
+
+int main(int argc, char* argv[]) {
+  bool checkOnly = argc == 2 && std::string_view{argv[1]} == "--check";
+  bool ok = true;
+  runOnStack(kStack, [&] {
+    for (const Nesting& nesting : kNestings) {
+      if (checkOnly) {
+        std::string program = nested(nesting, kDepths[std::size(kDepths) - 1]);
+        Parser parser{Lexer{program}};
+        if (!parser.parse()->find(Symbol{"x"})) {
+          std::cout << "FAILED: " << nesting.name << " does not define x\n";
+          ok = false;
+        }
+        continue;
+      }
+      std::cout << nesting.name << ", us per level:";
+      double first = 0;
+      double last = 0;
+      for (size_t depth : kDepths) {
+        std::string program = nested(nesting, depth);
+        double seconds = bestSeconds(kRuns, [&] {
+          Parser parser{Lexer{program}};
+          parser.parse();
+        });
+        last = seconds * 1e6 / static_cast<double>(depth);
+        if (first == 0) first = last;
+        std::cout << ' ' << depth << ": " << last;
+      }
+      std::cout << '\n';
+      if (last > first * kLinearSlack) {
+        std::cout << "FAILED: " << nesting.name << " is not linear\n";
+        ok = false;
+      }
+    }
+  });
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+// Parser throughput - the input is lexed once into a token buffer, which the
+// parser then indexes; this times the two apart, over a file or a generated
+// program
+//   parser_bench [file.coco]
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.h"
+#include "lexer.h"
+#include "parser.h"
+#include "source_buffer.h"
+#include "token.h"
+
+constexpr int kRuns = 3;
+constexpr size_t kGeneratedBytes = 8 << 20;
+
+int main(int argc, char* argv[]) {
+  std::optional<SourceBuffer> file;
+  std::string generated;
+  std::string_view input;
+  if (argc == 2) {
+    file.emplace(argv[1]);
+    input = file->view();
+  } else {
+    generated = generateProgram(kGeneratedBytes);
+    input = generated;
+  }
+  double megabytes = static_cast<double>(input.size()) / 1e6;
+  size_t tokens = 0;
+  double lexing =
+      bestSeconds(kRuns, [&] { tokens = Lexer{input}.tokenize().size(); });
+  // The parser lexes its input in its constructor, and parse() reads only
+  // the token buffer
+  double parsing = 1e30;
+  double whole = bestSeconds(kRuns, [&] {
+    Parser parser{Lexer{input}};
+    parsing = std::min(parsing, bestSeconds(1, [&] { parser.parse(); }));
+  });
+  std::cout << "input: " << megabytes << " MB, " << tokens << " tokens\n"
+            << "lex: " << lexing << " s, " << megabytes / lexing << " MB/s\n"
+            << "parse from tokens: " << parsing << " s, "
+            << static_cast<double>(tokens) / parsing / 1e6
+            << " M tokens/s\n"
+            << "lex and parse: " << whole << " s, " << megabytes / whole
+            << " MB/s\n";
+  return 0;
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#include "arena.h"
+
+#include <algorithm>
+
+void Arena::reset() {
+  // Objects may still point at each other, so destroy all of them before
+  // freeing any memory
+  for (Finalizer* at = finalizers; at;) {
+    Finalizer* next = at->next;
+    at->destroy(at);
+    at = next;
+  }
+  finalizers = nullptr;
+  for (char* block : blocks) {
+    ::operator delete(block);
+  }
+  blocks.clear();
+  cursor = limit = nullptr;
+  held = 0;
+}
+void Arena::adopt(Arena& other) {
+  if (&other == this) return;
+  if (other.finalizers) {
+    Finalizer* last = other.finalizers;
+    while (last->next) last = last->next;
+    last->next = finalizers;
+    finalizers = other.finalizers;
+  }
+  blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+  held += other.held;
+  other.finalizers = nullptr;
+  other.blocks.clear();
+  other.cursor = other.limit = nullptr;
+  other.held = 0;
+}
+// Start a new block big enough for the request
+void* Arena::grow(size_t size, size_t align) {
+  size_t blockSize = std::max(kBlockSize, size + align);
+  char* block = static_cast<char*>(::operator new(blockSize));
+  blocks.push_back(block);
+  held += blockSize;
+  cursor = block;
+  limit = block + blockSize;
+  return allocate(size, align);
+}
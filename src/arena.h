@@ -0,0 +1,89 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_ARENA_H_
+#define INCLUDE_SRC_ARENA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+// Arena - bump-pointer allocator for AST nodes and environments. Objects live
+// until the arena is reset or destroyed, and are never freed one at a time.
+// Objects that need destructors (strings, vectors, shared types) are recorded
+// and destroyed in one flat pass, so freeing a deep tree never recurses.
+// Also a memory resource, so containers inside nodes can allocate here too.
+// Not thread safe
+class Arena : public std::pmr::memory_resource {
+ public:
+  static constexpr size_t kBlockSize = 64 * 1024;
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena() override { reset(); }
+
+  // Construct a T in the arena
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    if constexpr (std::is_trivially_destructible_v<T>) {
+      return new (allocate(sizeof(T), alignof(T)))
+          T(std::forward<Args>(args)...);
+    } else {
+      // Record the destructor just in front of the object
+      constexpr size_t offset =
+          (sizeof(Finalizer) + alignof(T) - 1) / alignof(T) * alignof(T);
+      char* at = static_cast<char*>(allocate(
+          offset + sizeof(T), std::max(alignof(T), alignof(Finalizer))));
+      T* object = new (at + offset) T(std::forward<Args>(args)...);
+      finalizers = new (at) Finalizer{
+          [](Finalizer* finalizer) {
+            reinterpret_cast<T*>(reinterpret_cast<char*>(finalizer) + offset)
+                ->~T();
+          },
+          finalizers};
+      return object;
+    }
+  }
+  // Return uninitialized, aligned memory
+  void* allocate(size_t size, size_t align) {
+    uintptr_t at = (reinterpret_cast<uintptr_t>(cursor) + align - 1) &
+                   ~static_cast<uintptr_t>(align - 1);
+    if (at + size > reinterpret_cast<uintptr_t>(limit)) {
+      return grow(size, align);
+    }
+    cursor = reinterpret_cast<char*>(at + size);
+    return reinterpret_cast<void*>(at);
+  }
+  // Destroy every object, newest first, and free every block
+  void reset();
+  // Take over every object of other, which is left empty - objects made on
+  // another thread then live as long as those made here
+  void adopt(Arena& other);
+  // Return the number of bytes held in blocks
+  size_t used() const { return held; }
+
+ private:
+  struct Finalizer {
+    void (*destroy)(Finalizer*);
+    Finalizer* next;
+  };
+  void* grow(size_t size, size_t align);
+  // Memory resource interface - memory is only given back by reset()
+  void* do_allocate(size_t size, size_t align) override {
+    return allocate(size, align);
+  }
+  void do_deallocate(void*, size_t, size_t) override {}
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+  char* cursor = nullptr;
+  char* limit = nullptr;
+  std::vector<char*> blocks;
+  size_t held = 0;
+  Finalizer* finalizers = nullptr;
+};
+
+#endif  // INCLUDE_SRC_ARENA_H_
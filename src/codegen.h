@@ -6,7 +6,7 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Value.h>
 
-#include <unordered_map>
+#include <vector>
 
 #include "environment.h"
 #include "expr.h"
@@ -18,24 +18,52 @@ using llvm::Module;
 using llvm::Value;
 
 // Generate code with LLVM
-class CodeGen : public ExprVisitor<Value*>, StmtVisitor<Value*> {
+class CodeGen : public ExprVisitor<CodeGen, Value*>,
+                public StmtVisitor<CodeGen, Value*> {
  private:
   llvm::LLVMContext* context;
   llvm::IRBuilder<>* builder;
   llvm::Module* module;
   Environment* program;
-  std::unordered_map<std::string, llvm::AllocaInst*> varEnv;
+  // Variable of each declaration by slot - the globals, then the locals of
+  // the global being generated and of each function in it, outermost first
+  std::vector<std::vector<llvm::AllocaInst*>> frames;
+  // Binary expressions visitBinaryExpr is inside of, outermost first
+  std::vector<Expr*> binaries;
+  // LLVM type of each struct type made so far, by type id
+  std::vector<llvm::StructType*> structs;
+  // The printf every call is made to, declared once
+  llvm::Function* printfFunction;
+  // Return the variable of the declaration a name resolved to, nullptr if
+  // it has none in the frames being generated
+  llvm::AllocaInst* variable(const DeclarationRef& ref) {
+    if (!ref.resolved() || ref.depth >= frames.size()) return nullptr;
+    return frames[ref.depth][ref.slot];
+  }
+  // Return where the value of a variable or a field of one is kept, nullptr
+  // if it is not kept anywhere
+  Value* address(Expr* expr) {
+    if (expr->isLiteralExpr()) {
+      return variable(expr->getLiteralExpr()->declaration);
+    }
+    if (!expr->isGetExpr()) return nullptr;
+    Expr* object = expr->getGetExpr()->expr;
+    Value* base = address(object);
+    if (!base) return nullptr;
+    return builder->CreateStructGEP(generateType(object->type.get()), base,
+                                    expr->getGetExpr()->field);
+  }
 
  public:
   // Constructor (no implementation)
   CodeGen(Environment* program, LLVMContext* context, IRBuilder<>* builder,
           Module* module)
-      : context(context), builder(builder), module(module), program(program) {
-   llvm::Function::Create(llvm::FunctionType::get(builder->getInt8PtrTy(), true), llvm::GlobalValue::ExternalLinkage, "printf", module);
-  }
+      : context(context), builder(builder), module(module), program(program),
+        frames(1, std::vector<llvm::AllocaInst*>(program->members.size())),
+        printfFunction(llvm::Function::Create(llvm::FunctionType::get(builder->getInt8PtrTy(), true), llvm::GlobalValue::ExternalLinkage, "printf", module)) {}
   // Generate code for a prefix expr
-  Value* visitPrefixExpr(Expr* expr) override {
-    Value* exp = _visitExpr(expr->getPrefixExpr()->expr.get());
+  Value* visitPrefixExpr(Expr* expr) {
+    Value* exp = _visitExpr(expr->getPrefixExpr()->expr);
     // Add int or float token
     switch (expr->getPrefixExpr()->op) {
       case TOKEN_TYPE::MINUS:
@@ -56,31 +84,46 @@ class CodeGen : public ExprVisitor<Value*>, StmtVisitor<Value*> {
     }
   }
   // Generate code for an int expr
-  Value* visitIntExpr(Expr* expr) override {
+  Value* visitIntExpr(Expr* expr) {
     return llvm::ConstantInt::get(*context,
                                   llvm::APInt(32, expr->getInt(), true));
   }
   // Generate code for a float expr
-  Value* visitFloatExpr(Expr* expr) override {
+  Value* visitFloatExpr(Expr* expr) {
     return llvm::ConstantFP::get(*context, llvm::APFloat(expr->getFloat()));
   }
-  Value* visitBoolExpr(Expr* expr) override {
+  Value* visitBoolExpr(Expr* expr) {
     return llvm::ConstantInt::get(
         *context, llvm::APInt(1, expr->getBoolExpr()->val, true));
   }
-  Value* visitCharExpr(Expr* expr) override {
+  Value* visitCharExpr(Expr* expr) {
     return llvm::ConstantInt::get(*context,
                                   llvm::APInt(8, expr->getCharExpr()->c, true));
   }
-  Value* visitStringExpr(Expr* expr) override {
+  Value* visitStringExpr(Expr* expr) {
     return builder->CreateGlobalStringPtr(expr->getStringExpr()->str.c_str());
   }
-  // Generate code for a binary expr, visiting both children
-  Value* visitBinaryExpr(Expr* expr) override {
-    Value* left = _visitExpr(expr->getBinaryExpr()->left.get());
-    Value* right = _visitExpr(expr->getBinaryExpr()->right.get());
+  // Generate code for a binary expr - the chain of left sides is walked with
+  // an explicit stack, so long chains take no stack frame per operator
+  Value* visitBinaryExpr(Expr* expr) {
+    size_t base = binaries.size();
+    Expr* leftmost = expr;
+    while (leftmost->isBinaryExpr()) {
+      binaries.push_back(leftmost);
+      leftmost = leftmost->getBinaryExpr()->left;
+    }
+    Value* left = _visitExpr(leftmost);
+    for (size_t i = binaries.size(); i-- > base;) {
+      Value* right = _visitExpr(binaries[i]->getBinaryExpr()->right);
+      left = generateBinary(binaries[i], left, right);
+    }
+    binaries.resize(base);
+    return left;
+  }
+  // Generate code for one binary operator, given its sides
+  Value* generateBinary(Expr* expr, Value* left, Value* right) {
     if(expr->getBinaryExpr()->op == TOKEN_TYPE::ASSIGN) {
-      return builder->CreateStore(right, varEnv[expr->getBinaryExpr()->left->getLiteralExpr()->name]);
+      return builder->CreateStore(right, address(expr->getBinaryExpr()->left));
     }
     if (expr->type == program->bottomTypes.intType) {
       // Add int operations
@@ -180,71 +223,83 @@ class CodeGen : public ExprVisitor<Value*>, StmtVisitor<Value*> {
     }
   }
   // Generate code for type conversions
-  Value* visitTypeConvExpr(Expr* expr) override {
-    Value* exp = _visitExpr(expr->getTypeConvExpr()->expr.get());
+  Value* visitTypeConvExpr(Expr* expr) {
+    Value* exp = _visitExpr(expr->getTypeConvExpr()->expr);
     return builder->CreateSIToFP(exp, builder->getDoubleTy());
   }
 
-  void enterStmtVisitor() override {};
-  void exitStmtVisitor() override {};
-  Value* visitContinueStmt(Stmt* continueStmt) override {
+  void enterStmtVisitor() {};
+  void exitStmtVisitor() {};
+  Value* visitContinueStmt(Stmt* continueStmt) {
 
   };
-  Value* visitDeclarationStmt(Stmt* declarationStmt) override {
-    Value* val = declarationStmt->getDeclarationStmt()->val ? _visitExpr(declarationStmt->getDeclarationStmt()->val.get()) : nullptr;
+  Value* visitDeclarationStmt(Stmt* declarationStmt) {
+    // The value of a global has a frame of its own, for the lets in it
+    bool global = frames.size() == 1;
+    if (global) {
+      frames.emplace_back(declarationStmt->getDeclarationStmt()->locals.size());
+    }
+    Value* val = declarationStmt->getDeclarationStmt()->val ? _visitExpr(declarationStmt->getDeclarationStmt()->val) : nullptr;
+    if (global) frames.pop_back();
     if(declarationStmt->getDeclarationStmt()->val->isFunctionExpr()) return llvm::Constant::getNullValue(builder->getInt32Ty());
 
     IRBuilder<> TmpB(builder->GetInsertBlock());
-    varEnv[declarationStmt->getDeclarationStmt()->name] = builder->CreateAlloca(generateType(declarationStmt->type.get()), nullptr, declarationStmt->getDeclarationStmt()->name.c_str());
+    llvm::AllocaInst* alloca = builder->CreateAlloca(generateType(declarationStmt->type.get()), nullptr, llvm::StringRef{declarationStmt->getDeclarationStmt()->name.str()});
+    if (declarationStmt->getDeclarationStmt()->slot < frames.back().size()) {
+      frames.back()[declarationStmt->getDeclarationStmt()->slot] = alloca;
+    }
     if(val) {
-      builder->CreateStore(val, varEnv[declarationStmt->getDeclarationStmt()->name]);
+      builder->CreateStore(val, alloca);
       return val;
     }
     return llvm::Constant::getNullValue(builder->getInt32Ty());
 
   };
-  Value* visitReturnStmt(Stmt* returnStmt) override {
-    Value* returner = _visitExpr(returnStmt->getReturnStmt()->val.get());
+  Value* visitReturnStmt(Stmt* returnStmt) {
+    Value* returner = _visitExpr(returnStmt->getReturnStmt()->val);
     builder-> CreateRet(returner);
     return returner;
   };
-  Value* visitYieldStmt(Stmt* yieldStmt) override {
-    Value* yield = _visitExpr(yieldStmt->getYieldStmt()->val.get());
+  Value* visitYieldStmt(Stmt* yieldStmt) {
+    Value* yield = _visitExpr(yieldStmt->getYieldStmt()->val);
     return yield;
   };
-  Value* visitExprStmt(Stmt* exprStmt) override {
-    Value* ret = _visitExpr(exprStmt->getExprStmt()->val.get());
+  Value* visitExprStmt(Stmt* exprStmt) {
+    Value* ret = _visitExpr(exprStmt->getExprStmt()->val);
     return ret;
   };
-  Value* visitClassStmt(Stmt* classStmt) override {};
-  Value* visitImplStmt(Stmt* implStmt) override {};
-  Value* visitTypeDef(Stmt* typeDef) override {
+  Value* visitClassStmt(Stmt* classStmt) {};
+  Value* visitImplStmt(Stmt* implStmt) {};
+  Value* visitTypeDef(Stmt* typeDef) {
   };
-  Value* visitVoidExpr(Expr* voidExpr) override {return llvm::ConstantInt::get(*context, llvm::APInt(1, 0, true));};
-  Value* visitLiteralExpr(Expr* literalExpr) override {
-    if(varEnv.find(literalExpr->getLiteralExpr()->name) == varEnv.end()) {
+  Value* visitVoidExpr(Expr* voidExpr) {return llvm::ConstantInt::get(*context, llvm::APInt(1, 0, true));};
+  Value* visitLiteralExpr(Expr* literalExpr) {
+    llvm::AllocaInst* alloca = variable(literalExpr->getLiteralExpr()->declaration);
+    if(!alloca) {
       std::cerr << "Couldn't find Literal Expression";
     }
-    return builder->CreateLoad(generateType(literalExpr->type.get()), varEnv[literalExpr->getLiteralExpr()->name], literalExpr->getLiteralExpr()->name.c_str());
+    return builder->CreateLoad(generateType(literalExpr->type.get()), alloca, llvm::StringRef{literalExpr->getLiteralExpr()->name.str()});
   };
-  Value* visitFunctionExpr(Expr* functionExpr) override {
+  Value* visitFunctionExpr(Expr* functionExpr) {
     std::vector<llvm::Type*> paramTypes;
     for(int i = 0; i < functionExpr->getFunctionExpr()->parameters->members.size(); ++i) {
       paramTypes.emplace_back(generateType(functionExpr->getFunctionExpr()->parameters->getInOrder(i)->type.get()));
     }
     llvm::Type* returner = generateType(functionExpr->getFunctionExpr()->returnType.get());
-    auto* newFun = llvm::Function::Create(llvm::FunctionType::get(returner, paramTypes, false), llvm::Function::ExternalLinkage, functionExpr->getFunctionExpr()->name.c_str(), module);
+    auto* newFun = llvm::Function::Create(llvm::FunctionType::get(returner, paramTypes, false), llvm::Function::ExternalLinkage, llvm::StringRef{functionExpr->getFunctionExpr()->name.str()}, module);
     auto* entryBlock = llvm::BasicBlock::Create(*context, "funentry", newFun);
     builder->SetInsertPoint(entryBlock);
-    _visitExpr(functionExpr->getFunctionExpr()->action.get());
+    frames.emplace_back(functionExpr->getFunctionExpr()->locals.size());
+    _visitExpr(functionExpr->getFunctionExpr()->action);
+    frames.pop_back();
     return llvm::Constant::getNullValue(builder->getInt32Ty());
 
   };
-  Value* visitMatchExpr(Expr* matchExpr) override {
+  Value* visitMatchExpr(Expr* matchExpr) {
     return llvm::Constant::getNullValue(builder->getInt32Ty());
   };
-  Value* visitIfExpr(Expr* ifExpr) override {
-    auto* condVal = _visitExpr(ifExpr->getIfExpr()->cond.get());
+  Value* visitIfExpr(Expr* ifExpr) {
+    auto* condVal = _visitExpr(ifExpr->getIfExpr()->cond);
     auto* parent = builder->GetInsertBlock()->getParent();
     auto* then = llvm::BasicBlock::Create(*context, "thenExpr", parent);
     llvm::BasicBlock* elseExpr = nullptr;
@@ -255,13 +310,13 @@ class CodeGen : public ExprVisitor<Value*>, StmtVisitor<Value*> {
     auto* mergeAfter = llvm::BasicBlock::Create(*context, "continued");
     builder->CreateCondBr(condVal, then, elseExpr ? elseExpr : mergeAfter);
     builder->SetInsertPoint(then);
-    auto* thenVal = _visitExpr(ifExpr->getIfExpr()->thenExpr.get());
+    auto* thenVal = _visitExpr(ifExpr->getIfExpr()->thenExpr);
     builder->CreateBr(mergeAfter);
     then = builder->GetInsertBlock();
     if(elseExpr) {
       parent->insert(parent->end(), elseExpr);
       builder->SetInsertPoint(elseExpr);
-      elseVal = _visitExpr(ifExpr->getIfExpr()->elseExpr.get());
+      elseVal = _visitExpr(ifExpr->getIfExpr()->elseExpr);
 
       builder->CreateBr(mergeAfter);
       elseExpr = builder->GetInsertBlock();
@@ -278,30 +333,30 @@ class CodeGen : public ExprVisitor<Value*>, StmtVisitor<Value*> {
     return thenVal;
 
   };
-  Value* visitBlockExpr(Expr* blockExpr) override {
+  Value* visitBlockExpr(Expr* blockExpr) {
     auto* parent = builder->GetInsertBlock()->getParent();
     auto* block = llvm::BasicBlock::Create(*context, "block");
     builder->CreateBr(block);
     parent->insert(parent->end(), block);
     builder->SetInsertPoint(block);
     for(auto& stmt : blockExpr->getBlockExpr()->stmts) {
-      Value* val = _visitStmt(stmt.get());
+      Value* val = _visitStmt(stmt);
       if(stmt->isYieldStmt()) return val;
     }
     return llvm::Constant::getNullValue(builder->getInt32Ty());
   };
-  Value* visitForExpr(Expr* forExpr) override {};
-  Value* visitWhileExpr(Expr* whileExpr) override {
+  Value* visitForExpr(Expr* forExpr) {};
+  Value* visitWhileExpr(Expr* whileExpr) {
     auto* parent = builder->GetInsertBlock()->getParent();
-    auto* cond = _visitExpr(whileExpr->getWhileExpr()->cond.get());
+    auto* cond = _visitExpr(whileExpr->getWhileExpr()->cond);
     llvm::BasicBlock* loopBody = llvm::BasicBlock::Create(*context, "loop");
     llvm::BasicBlock* loopEnd = llvm::BasicBlock::Create(*context, "end");
     builder->CreateCondBr(cond, loopBody, loopEnd);
     parent->insert(parent->end(), loopBody);
     builder->SetInsertPoint(loopBody);
-    llvm::Value* val = _visitExpr(whileExpr->getWhileExpr()->body.get());
+    llvm::Value* val = _visitExpr(whileExpr->getWhileExpr()->body);
     auto* currentInsert = builder->GetInsertBlock();
-    cond = _visitExpr(whileExpr->getWhileExpr()->cond.get());
+    cond = _visitExpr(whileExpr->getWhileExpr()->cond);
     builder->CreateCondBr(cond, loopBody, loopEnd);
     parent->insert(parent->end(), loopEnd);
     builder->SetInsertPoint(loopEnd);
@@ -309,19 +364,26 @@ class CodeGen : public ExprVisitor<Value*>, StmtVisitor<Value*> {
 
 
   };
-  Value* visitGetExpr(Expr* getExpr) override {};
-  Value* visitCallExpr(Expr* callExpr) override {
-    auto* func = module->getFunction("printf");
+  // A field is loaded through one constant-index GEP off its object's
+  // address, or taken out of an object that has none
+  Value* visitGetExpr(Expr* getExpr) {
+    if (Value* field = address(getExpr)) {
+      return builder->CreateLoad(generateType(getExpr->type.get()), field);
+    }
+    return builder->CreateExtractValue(_visitExpr(getExpr->getGetExpr()->expr),
+                                       getExpr->getGetExpr()->field);
+  };
+  Value* visitCallExpr(Expr* callExpr) {
     std::vector<Value*> arguments;
     for(auto& param : callExpr->getCallExpr()->params) {
-      arguments.emplace_back(_visitExpr(param.get()));
+      arguments.emplace_back(_visitExpr(param));
     }
-    return builder->CreateCall(func, arguments);
+    return builder->CreateCall(printfFunction, arguments);
   };
   // Enter a visitor (no implementation)
-  void enterExprVisitor() override {}
+  void enterExprVisitor() {}
   // Exit a visitor (no implementation)
-  void exitExprVisitor() override {}
+  void exitExprVisitor() {}
   // Use default copy and destructor operations
   CodeGen(CodeGen&&) = default;
   CodeGen(const CodeGen&) = default;
@@ -332,8 +394,26 @@ class CodeGen : public ExprVisitor<Value*>, StmtVisitor<Value*> {
 
  private:
   llvm::Type* generateType(Type* exprType) {
+    // Types that could not be resolved were reported by the type resolver
+    if(!exprType) return builder->getInt32Ty();
+    // Aliases point straight at their types once resolved
     if(exprType->isAliasType()) {
       return generateType(exprType->getAliasType()->type.get());
+    } else if(exprType->isStructType()) {
+      // Made once per struct, and kept before its fields are, so a field
+      // that leads back to the struct finds it
+      if (exprType->id < structs.size() && structs[exprType->id]) {
+        return structs[exprType->id];
+      }
+      if (exprType->id >= structs.size()) structs.resize(exprType->id + 1);
+      llvm::StructType* type = llvm::StructType::create(*context);
+      structs[exprType->id] = type;
+      std::vector<llvm::Type*> fields;
+      for (AliasType& field : exprType->getStructType()->types) {
+        fields.emplace_back(generateType(field.type.get()));
+      }
+      type->setBody(fields);
+      return type;
     } else if(exprType->isBottomType()) {
       switch (exprType->getBottomType()) {
         case BottomType::INT:
@@ -349,6 +429,8 @@ class CodeGen : public ExprVisitor<Value*>, StmtVisitor<Value*> {
         case BottomType::SELF:
           std::cerr << "Error: Unsubstantiated Type.\n";
           break;
+        case BottomType::ERROR:
+          break;
       }
     }
     return builder->getInt32Ty();
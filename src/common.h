@@ -1,8 +1,11 @@
 // Copyright (c) 2024 Compile Collective. All Rights Reserved.
 #ifndef INCLUDE_SRC_COMMON_H_
 #define INCLUDE_SRC_COMMON_H_
-#include <string_view>
+#include <cstddef>
 #include <iostream>
+#include <string_view>
+#include <type_traits>
+#include <variant>
 // Allow line and character to be accessible anywhere in the code
 struct SourceLocation {
   int line;
@@ -13,5 +16,18 @@ template <class... Ts>
 struct overloaded : Ts... {
   using Ts::operator()...;
 };
+// Position of T among the alternatives of a variant, as a constant
+template <typename T, typename Variant>
+struct AlternativeIndex;
+template <typename T, typename... Ts>
+struct AlternativeIndex<T, std::variant<Ts...>> {
+  static constexpr size_t value = [] {
+    constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+    size_t index = 0;
+    while (index < sizeof...(Ts) && !matches[index]) ++index;
+    return index;
+  }();
+  static_assert(value < sizeof...(Ts), "Not an alternative of the variant");
+};
 void exitError(const SourceLocation& loc, const std::string_view& str);
 #endif  // INCLUDE_SRC_COMMON_H_
@@ -1,4 +1,114 @@
 // Copyright (c) 2024 Compile Collective. All Rights Reserved.
 #include "environment.h"
 
-// No implementation
+#include <utility>
+
+// Return the type a name stands for
+std::shared_ptr<Type> Environment::getType(Symbol name, Stmt* member,
+                                           std::ostream& errors) {
+  if (std::shared_ptr<Type> bottom = bottomType(name)) return bottom;
+  // Identifier, ensure proper type
+  if (!member) {
+    // Not defined yet, resolved after parsing
+    return types->unresolved(name);
+  }
+  if (member->isTypeDef()) {
+    return member->getTypeDef()->type;
+  } else if (member->isClassStmt()) {
+    return member->getClassStmt()->structType;
+  } else if (member->isImplStmt()) {
+    return member->getImplStmt()->implType;
+  }
+  errors << "Identifier is not of a valid type.\n";
+  return nullptr;
+}
+// Return the bottom type name stands for
+std::shared_ptr<Type> Environment::bottomType(Symbol name) const {
+  std::string_view text = name.str();
+  if (text == "int") return bottomTypes.intType;
+  if (text == "float") return bottomTypes.floatType;
+  if (text == "void") return bottomTypes.voidType;
+  if (text == "char") return bottomTypes.charType;
+  if (text == "bool") return bottomTypes.boolType;
+  return nullptr;
+}
+// Add a name to members and order
+bool Environment::addMember(Symbol name, Stmt environ) {
+  uint32_t slot = slotOf(name);
+  if (slot != SymbolIndex::kNone) {
+    order.push_back(slot);
+    return false;
+  }
+  slot = static_cast<uint32_t>(members.size());
+  members.push_back(std::move(environ));
+  names.push_back(name);
+  order.push_back(slot);
+  auto nameOf = [this](uint32_t at) { return names[at]; };
+  if (members.size() == kScanMembers + 1) {
+    for (uint32_t at = 0; at < members.size(); ++at) {
+      index.set(names[at], at, nameOf);
+    }
+  } else if (members.size() > kScanMembers) {
+    index.set(name, slot, nameOf);
+  }
+  return true;
+}
+// Take back the name added last
+void Environment::removeLast(bool defined) {
+  order.pop_back();
+  if (!defined) return;
+  if (members.size() > kScanMembers) {
+    index.erase(names.back(), [this](uint32_t at) { return names[at]; });
+  }
+  members.pop_back();
+  names.pop_back();
+}
+// Return the slot of the member with name here
+uint32_t Environment::slotOf(Symbol name) const {
+  if (members.size() > kScanMembers) {
+    return index.find(name, [this](uint32_t at) { return names[at]; });
+  }
+  for (uint32_t at = 0; at < names.size(); ++at) {
+    if (names[at] == name) return at;
+  }
+  return SymbolIndex::kNone;
+}
+// Open a scope for env
+void ScopedTable::push(Environment* env) {
+  scopes.push_back(env);
+  marks.push_back(bindings.size());
+  for (uint32_t slot = 0; slot < env->members.size(); ++slot) {
+    bind(env->names[slot], slot);
+  }
+}
+// Close the innermost scope
+void ScopedTable::pop() {
+  auto nameOf = [this](uint32_t at) { return bindings[at].name; };
+  for (size_t at = bindings.size(); at-- > marks.back();) {
+    const Binding& binding = bindings[at];
+    if (binding.shadowed == kNone) {
+      heads.erase(binding.name, nameOf);
+    } else {
+      heads.set(binding.name, binding.shadowed, nameOf);
+    }
+  }
+  bindings.resize(marks.back());
+  marks.pop_back();
+  scopes.pop_back();
+}
+// Make a member of the innermost scope visible
+void ScopedTable::bind(Symbol name, uint32_t slot) {
+  auto nameOf = [this](uint32_t at) { return bindings[at].name; };
+  uint32_t scope = static_cast<uint32_t>(scopes.size() - 1);
+  uint32_t shadowed = heads.find(name, nameOf);
+  if (shadowed != kNone && bindings[shadowed].scope == scope) return;
+  bindings.push_back(Binding{name, scope, slot, shadowed});
+  heads.set(name, static_cast<uint32_t>(bindings.size() - 1), nameOf);
+}
+// Return the innermost member with name in an open scope
+Stmt* ScopedTable::find(Symbol name) const {
+  uint32_t head =
+      heads.find(name, [this](uint32_t at) { return bindings[at].name; });
+  if (head == kNone) return nullptr;
+  return &scopes[bindings[head].scope]->members[bindings[head].slot];
+}
@@ -1,12 +1,18 @@
 // Copyright (c) 2024 Compile Collective. All Rights Reserved.
 #ifndef SENIORPROJECT_ENVIRONMENT_H
 #define SENIORPROJECT_ENVIRONMENT_H
+#include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <span>
-#include <unordered_map>
+#include <vector>
 
+#include "arena.h"
 #include "stmt.h"
+#include "symbol.h"
+#include "symbol_index.h"
+#include "type_context.h"
 #include "types.h"
 
 // Collection of environment information
@@ -24,44 +30,140 @@ struct Environment {
   };
   Environment* prev = nullptr;
   BottomTypes bottomTypes;
-  std::unordered_map<std::string, Stmt> members;
-  std::vector<std::string> order;
-  // Return an environment object
-  std::unique_ptr<Environment> generateInnerEnvironment() {
-    return std::make_unique<Environment>(Environment{this, this->bottomTypes,
-                       std::unordered_map<std::string, Stmt>{}});
+  // Members in one array, in the order their names were first added, and
+  // the name of each. Those of inner environments (blocks, parameters) are
+  // small and live in the arena; the program's grow with it, so they are
+  // kept off the arena, which could not take back the buffers they outgrow
+  std::pmr::vector<Stmt> members;
+  std::pmr::vector<Symbol> names;
+  // Slot in members of every name added, in order; a name added again (a
+  // redefinition) repeats the slot of the first member under it
+  std::pmr::vector<uint32_t> order;
+  // Globals each global names, by slot - those the global at slot names are
+  // uses[usesBegin[slot]] up to uses[usesBegin[slot + 1]]. Set by the
+  // resolver, in the program only
+  std::vector<uint32_t> uses;
+  std::vector<uint32_t> usesBegin;
+  // Arena this environment, its members and inner environments live in
+  Arena* arena;
+  // Context every type of the program is made in, shared by inner
+  // environments
+  TypeContext* types;
+  explicit Environment(Arena* arena, Environment* prev = nullptr,
+                       BottomTypes bottomTypes = {})
+      : prev(prev),
+        bottomTypes(std::move(bottomTypes)),
+        members(resourceFor(arena, prev)),
+        names(resourceFor(arena, prev)),
+        order(resourceFor(arena, prev)),
+        arena(arena),
+        types(prev ? prev->types : nullptr),
+        index(resourceFor(arena, prev)) {}
+  // Return an environment nested in this one
+  Environment* generateInnerEnvironment() {
+    return arena->make<Environment>(arena, this, bottomTypes);
   }
-  // Add a name to members and order
-  void addMember(std::string name, Stmt environ) {
-    members.emplace(name, std::move(environ));
-    order.emplace_back(name);
+  // Add a name to members and order; returns false, keeping the first
+  // member, if the name is already here
+  bool addMember(Symbol name, Stmt environ);
+  // Make room for count names
+  void reserve(size_t count) {
+    members.reserve(count);
+    names.reserve(count);
+    order.reserve(count);
+  }
+  // Take back the name added last; defined says if it added its member
+  void removeLast(bool defined);
+  // Return the slot of the member with name here, SymbolIndex::kNone if none
+  uint32_t slotOf(Symbol name) const;
+  // Return member with name here (not in prev); nullptr if not
+  Stmt* find(Symbol name) {
+    uint32_t slot = slotOf(name);
+    return slot == SymbolIndex::kNone ? nullptr : &members[slot];
   }
   // Return the appropriate redeclaration state
-  REDECLARATION_STATES isRedeclaration(const std::string& name) {
-    if (members.find(name) != members.end()) {
-      return REDECLARATION_STATES::REDECLARATION;
-    } else if (prev &&
-               prev->isRedeclaration(name) != REDECLARATION_STATES::UNIQUE) {
-      return REDECLARATION_STATES::ALIAS;
+  REDECLARATION_STATES isRedeclaration(Symbol name) {
+    if (find(name)) return REDECLARATION_STATES::REDECLARATION;
+    for (Environment* env = prev; env; env = env->prev) {
+      if (env->find(name)) return REDECLARATION_STATES::ALIAS;
     }
     return REDECLARATION_STATES::UNIQUE;
   }
   // Return member with name if it exists, perhaps in the prev environment; nullptr if not 
-  Stmt* getMember(const std::string& name) {
-    if (members.find(name) != members.end()) {
-      return &members[name];
+  Stmt* getMember(Symbol name) {
+    for (Environment* env = this; env; env = env->prev) {
+      if (Stmt* member = env->find(name)) return member;
     }
-    if (!prev) return nullptr;
-    return prev->getMember(name);
+    return nullptr;
+  }
+  // Return the type a name stands for - a bottom type, or a type definition,
+  // class, or impl; an alias to resolve later if the name is not defined yet
+  std::shared_ptr<Type> getType(Symbol name) {
+    return getType(name, getMember(name));
   }
+  // As above, given the member found under name
+  std::shared_ptr<Type> getType(Symbol name, Stmt* member,
+                                std::ostream& errors = std::cerr);
+  // Return the bottom type name stands for, nullptr if it is not one
+  std::shared_ptr<Type> bottomType(Symbol name) const;
   // Return a stmt based on numeric index rather than name
   Stmt* getInOrder(size_t elem) {
-    return elem < members.size() ? &members.at(order[elem]) : nullptr;
+    return elem < members.size() ? &members[order[elem]] : nullptr;
+  }
+  // Return an empty environment nested in this one
+  Environment* clone() {
+    return arena->make<Environment>(arena, this);
+  }
+
+ private:
+  // Memory the arrays of an environment are kept in - the arena, unless it
+  // is the program
+  static std::pmr::memory_resource* resourceFor(Arena* arena,
+                                                Environment* prev) {
+    if (prev) return arena;
+    return std::pmr::get_default_resource();
   }
-  // Clone a pointer to this environment
-  std::unique_ptr<Environment> clone() {
-    return std::make_unique<Environment>(this);
+  // Small environments (most blocks and parameter lists) are searched in
+  // names; past this many members, slots are found through index
+  static constexpr size_t kScanMembers = 8;
+  SymbolIndex index;
+};
+// Scoped table - every member visible from the innermost of a stack of
+// nested environments, in one flat hash from each name to the binding that
+// shadows the others. A scope is opened and closed in constant time plus
+// its own bindings, which are undone newest first
+class ScopedTable {
+ public:
+  // Open a scope for env, nested in the current one, with env's members
+  void push(Environment* env);
+  // Close the innermost scope, uncovering the bindings it shadowed
+  void pop();
+  // Make member slot of the innermost scope's environment visible as name,
+  // unless that scope has the name already
+  void bind(Symbol name, uint32_t slot);
+  // Return the innermost member with name in an open scope, nullptr if none
+  Stmt* find(Symbol name) const;
+  // Return the environment the open scopes are nested in - current if none
+  // are open
+  Environment* outer(Environment* current) const {
+    return scopes.empty() ? current : scopes.front()->prev;
   }
+
+ private:
+  static constexpr uint32_t kNone = SymbolIndex::kNone;
+  struct Binding {
+    Symbol name;
+    uint32_t scope;
+    uint32_t slot;
+    uint32_t shadowed;  // Binding of the name before this one, or kNone
+  };
+  // Environment of each open scope, and the bindings when it was opened
+  std::vector<Environment*> scopes;
+  std::vector<size_t> marks;
+  // Every binding of the open scopes, oldest first - also the undo log
+  std::vector<Binding> bindings;
+  // Newest binding of each name
+  SymbolIndex heads;
 };
 
 #endif  // SENIORPROJECT_ENVIRONMENT_H
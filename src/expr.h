@@ -2,6 +2,7 @@
 #ifndef INCLUDE_SRC_EXPR_H_
 #define INCLUDE_SRC_EXPR_H_
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string_view>
@@ -10,35 +11,29 @@
 #include <vector>
 
 #include "common.h"
+#include "symbol.h"
 #include "token.h"
 #include "types.h"
-template <typename T>
+template <typename Derived, typename T>
 struct ExprVisitor;
+class Arena;
 struct Expr;
 struct Stmt;
 struct Environment;
+// Child expressions, statements and environments are owned by the arena they
+// were made in, so nodes link to them with plain pointers and copy in O(1)
 // Binary expression - two expressions with an operation
 struct BinaryExpr {
-  std::unique_ptr<Expr> left;
-  std::unique_ptr<Expr> right;
+  Expr* left = nullptr;
+  Expr* right = nullptr;
   TOKEN_TYPE op;
   explicit BinaryExpr(const Token& opToken);
-  BinaryExpr(const BinaryExpr& binaryExpr);
-  BinaryExpr(BinaryExpr&& binaryExpr) noexcept;
-  BinaryExpr& operator=(const BinaryExpr& other);
-  BinaryExpr& operator=(BinaryExpr&& other) noexcept;
-  ~BinaryExpr();
 };
 // Prefix expression - expression with an operation before it
 struct PrefixExpr {
-  std::unique_ptr<Expr> expr;
+  Expr* expr = nullptr;
   TOKEN_TYPE op;
   explicit PrefixExpr(const Token& opToken);
-  PrefixExpr(const PrefixExpr& prefixExpr);
-  PrefixExpr(PrefixExpr&& prefixExpr) noexcept;
-  PrefixExpr& operator=(const PrefixExpr& other);
-  PrefixExpr& operator=(PrefixExpr&& other) noexcept;
-  ~PrefixExpr();
 };
 // Int expression - one integer
 struct IntExpr {
@@ -73,21 +68,27 @@ struct TypeConvExpr {
   bool implicit;
   std::shared_ptr<Type> from;  // Definitely won't stay TokenType
   std::shared_ptr<Type> to;
-  std::unique_ptr<Expr> expr;
+  Expr* expr = nullptr;
   explicit TypeConvExpr(bool implicit, std::shared_ptr<Type> from,
                         std::shared_ptr<Type> to);
   explicit TypeConvExpr(std::shared_ptr<Type> from, std::shared_ptr<Type> to);
-  TypeConvExpr(const TypeConvExpr& implicitTypeConvExpr);
-  TypeConvExpr(TypeConvExpr&& implicitTypeConvExpr) noexcept;
-  TypeConvExpr& operator=(const TypeConvExpr& other);
-  TypeConvExpr& operator=(TypeConvExpr&& other) noexcept;
-  ~TypeConvExpr();
 };
-// Literal expression - a string name
+// Declaration a name resolves to - the depth of the frame it is local to, and
+// its slot there. Depth 0 is the program's members, 1 the locals of the
+// global (or field or method) whose value it is in, and each function around
+// it one more
+struct DeclarationRef {
+  static constexpr uint32_t kUnresolved = UINT32_MAX;
+  uint32_t depth = 0;
+  uint32_t slot = kUnresolved;
+  bool resolved() const { return slot != kUnresolved; }
+};
+// Literal expression - a name, and the declaration the resolver bound it to
 struct LiteralExpr {
-  std::string name;
+  Symbol name;
+  DeclarationRef declaration;
   LiteralExpr() = default;
-  LiteralExpr(const std::string_view name) : name(name){};
+  LiteralExpr(Symbol name) : name(name){};
   LiteralExpr(const LiteralExpr& literalExpr) = default;
   LiteralExpr(LiteralExpr&& literalExpr) noexcept = default;
   LiteralExpr& operator=(const LiteralExpr& other) = default;
@@ -96,27 +97,14 @@ struct LiteralExpr {
 };
 // For condition expression - expression and literal expression
 struct ForConditionExpr {
-  std::unique_ptr<Expr> expr;
+  Expr* expr = nullptr;
   LiteralExpr var;
-  ForConditionExpr() = default;
-  ForConditionExpr(const ForConditionExpr& for_condition_expr);
-  ForConditionExpr(ForConditionExpr&& for_condition_expr) noexcept;
-  ForConditionExpr& operator=(const ForConditionExpr& other);
-  ForConditionExpr& operator=(ForConditionExpr&& other) noexcept;
-  ~ForConditionExpr();
 };
 // Case expression - type, condition, and body
 struct CaseExpr {
   std::shared_ptr<Type> type;
-  std::variant<std::string, std::unique_ptr<Expr>, std::shared_ptr<Type>> cond;
-  std::unique_ptr<Expr> body;
-  bool isStringCond() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::string, std::decay_t<decltype(arg)>>;
-        },
-        cond);
-  }
+  std::variant<Expr*, std::shared_ptr<Type>> cond;
+  Expr* body = nullptr;
   bool isTypeCond() const {
     return std::visit(
         [](auto&& arg) {
@@ -128,126 +116,77 @@ struct CaseExpr {
   bool isExprCond() const {
     return std::visit(
         [](auto&& arg) {
-          return std::is_same_v<std::unique_ptr<Expr>,
-                                std::decay_t<decltype(arg)>>;
+          return std::is_same_v<Expr*, std::decay_t<decltype(arg)>>;
         },
         cond);
   }
-  Expr* getExpr() const {
-    return std::get<std::unique_ptr<Expr>>(this->cond).get();
-  }
+  Expr* getExpr() const { return std::get<Expr*>(this->cond); }
   std::shared_ptr<Type> getTypeCase() const {
     return std::get<std::shared_ptr<Type>>(this->cond);
   }
-  CaseExpr() = default;
-  CaseExpr(const CaseExpr& caseExpr);
-  CaseExpr(CaseExpr&& caseExpr) noexcept;
-  CaseExpr& operator=(const CaseExpr& other);
-  CaseExpr& operator=(CaseExpr&& other) noexcept;
-  ~CaseExpr();
 };
 // Match expression - condition and cases
 struct MatchExpr {
-  std::unique_ptr<Expr> cond;
+  Expr* cond = nullptr;
   std::vector<CaseExpr> cases;
-  MatchExpr() = default;
-  MatchExpr(const MatchExpr& matchExpr);
-  MatchExpr(MatchExpr&& matchExpr) noexcept;
-  MatchExpr& operator=(const MatchExpr& other);
-  MatchExpr& operator=(MatchExpr&& other) noexcept;
-  ~MatchExpr();
 };
 // If expression - condition, if-then, if-else
 struct IfExpr {
-  std::unique_ptr<Expr> cond;
-  std::unique_ptr<Expr> thenExpr;
-  std::unique_ptr<Expr> elseExpr;
-  IfExpr() = default;
-  IfExpr(const IfExpr& ifExpr);
-  IfExpr(IfExpr&& ifExpr) noexcept;
-  IfExpr& operator=(const IfExpr& other);
-  IfExpr& operator=(IfExpr&& other) noexcept;
-  ~IfExpr();
+  Expr* cond = nullptr;
+  Expr* thenExpr = nullptr;
+  Expr* elseExpr = nullptr;
 };
 // Block expression - an environment (scope) with statements, and a possible
 // return or yield
 struct BlockExpr {
   bool returns;
   bool yields;
-  std::vector<std::unique_ptr<Stmt>> stmts;
-  std::unique_ptr<Environment> env;
-  BlockExpr() = default;
-  BlockExpr(const BlockExpr& blockExpr);
-  BlockExpr(BlockExpr&& blockExpr) noexcept;
-  BlockExpr& operator=(const BlockExpr& blockExpr);
-  BlockExpr& operator=(BlockExpr&& blockExpr) noexcept;
-  ~BlockExpr();
+  std::vector<Stmt*> stmts;
+  Environment* env = nullptr;
 };
 // For expression - an environment (scope) and a body
 struct ForExpr {
-  std::unique_ptr<Environment> env;
-  std::unique_ptr<Expr> body;
-  ForExpr() = default;
-  ForExpr(const ForExpr& forExpr);
-  ForExpr(ForExpr&& forExpr) noexcept;
-  ForExpr& operator=(const ForExpr& forExpr);
-  ForExpr& operator=(ForExpr&& forExpr) noexcept;
-  ~ForExpr();
+  Environment* env = nullptr;
+  Expr* body = nullptr;
 };
 // While expression - a condition and a body
 struct WhileExpr {
-  std::unique_ptr<Expr> cond;
-  std::unique_ptr<Expr> body;
-  WhileExpr() = default;
-  WhileExpr(const WhileExpr& whileExpr);
-  WhileExpr(WhileExpr&& whileExpr) noexcept;
-  WhileExpr& operator=(const WhileExpr& whileExpr);
-  WhileExpr& operator=(WhileExpr&& whileExpr) noexcept;
-  ~WhileExpr();
+  Expr* cond = nullptr;
+  Expr* body = nullptr;
 };
-// Get expression - an expression and a name
+// Get expression - an expression and a name, and the index of the field it
+// names in the expression's struct type, set by the type checker
 struct GetExpr {
-  std::unique_ptr<Expr> expr;
+  static constexpr uint32_t kNoField = UINT32_MAX;
+  Expr* expr = nullptr;
   LiteralExpr name;
-  GetExpr() : expr(nullptr), name("") {}
-  GetExpr(Expr expr, LiteralExpr name);
-  GetExpr(const GetExpr& getExpr);
-  GetExpr(GetExpr&& getExpr) noexcept;
-  GetExpr& operator=(const GetExpr& getExpr);
-  GetExpr& operator=(GetExpr&& getExpr) noexcept;
-  ~GetExpr();
+  uint32_t field = kNoField;
 };
 // Call expression - an expression with parameters
 struct CallExpr {
-  std::unique_ptr<Expr> expr;
-  std::vector<std::unique_ptr<Expr>> params;
-  CallExpr() = default;
-  CallExpr(const CallExpr& callExpr);
-  CallExpr(CallExpr&& callExpr) noexcept;
-  CallExpr& operator=(const CallExpr& callExpr);
-  CallExpr& operator=(CallExpr&& callExpr) noexcept;
-  ~CallExpr();
+  Expr* expr = nullptr;
+  std::vector<Expr*> params;
 };
 // Function expression - parameters, number of parameters, return type, and an
 // action
 struct FunctionExpr {
   int arity;
-  std::string name;
-  std::unique_ptr<Environment> parameters;
+  Symbol name;
+  Environment* parameters = nullptr;
   std::shared_ptr<Type> returnType;
-  std::unique_ptr<Expr> action;
-  FunctionExpr() = default;
-  FunctionExpr(const FunctionExpr& functionExpr);
-  FunctionExpr(FunctionExpr&& functionExpr) noexcept;
-  FunctionExpr& operator=(const FunctionExpr& functionExpr);
-  FunctionExpr& operator=(FunctionExpr&& functionExpr) noexcept;
-  ~FunctionExpr();
+  Expr* action = nullptr;
+  // Declaration of each local by slot - parameters first, then loop variables
+  // and lets as they appear; set by the resolver
+  std::vector<Stmt*> locals;
 };
-// Every expression is one of the preceding types
+// Every expression is one of the preceding types. Payloads bigger than a
+// binary expression are made in the arena and held by pointer, so that leaves
+// and operators stay small
 using InnerExpr =
     std::variant<BinaryExpr, PrefixExpr, IntExpr, FloatExpr, BoolExpr, CharExpr,
-                 StringExpr, LiteralExpr, FunctionExpr, TypeConvExpr, MatchExpr,
-                 IfExpr, BlockExpr, ForExpr, WhileExpr, GetExpr, CallExpr, VoidExpr>;
+                 StringExpr*, LiteralExpr, FunctionExpr*, TypeConvExpr*,
+                 MatchExpr*, IfExpr, BlockExpr*, ForExpr, WhileExpr, GetExpr,
+                 CallExpr*, VoidExpr>;
 // Main expression information
 struct Expr {
   SourceLocation sourceLocation;
@@ -255,63 +194,65 @@ struct Expr {
   InnerExpr innerExpr;
   // Accept a new inner expression
   void accept(const InnerExpr& inner_expr) { this->innerExpr = inner_expr; }
-  template <typename R>
-  // Visit the expression based on its inner type
-  R accept(ExprVisitor<R>* visitor) {
-    return std::visit(
-        [visitor, this](auto&& arg) -> R {
-          using T = std::decay_t<decltype(arg)>;
-          if (std::is_same_v<T, BinaryExpr>) {
-            return visitor->visitBinaryExpr(this);
-          } else if (std::is_same_v<T, PrefixExpr>) {
-            return visitor->visitPrefixExpr(this);
-          } else if (std::is_same_v<T, IntExpr>) {
-            return visitor->visitIntExpr(this);
-          } else if (std::is_same_v<T, FloatExpr>) {
-            return visitor->visitFloatExpr(this);
-          } else if (std::is_same_v<T, BoolExpr>) {
-            return visitor->visitBoolExpr(this);
-          } else if (std::is_same_v<T, CharExpr>) {
-            return visitor->visitCharExpr(this);
-          } else if (std::is_same_v<T, StringExpr>) {
-            return visitor->visitStringExpr(this);
-          } else if (std::is_same_v<T, LiteralExpr>) {
-            return visitor->visitLiteralExpr(this);
-          } else if (std::is_same_v<T, FunctionExpr>) {
-            return visitor->visitFunctionExpr(this);
-          } else if (std::is_same_v<T, TypeConvExpr>) {
-            return visitor->visitTypeConvExpr(this);
-          } else if (std::is_same_v<T, MatchExpr>) {
-            return visitor->visitMatchExpr(this);
-          } else if (std::is_same_v<T, IfExpr>) {
-            return visitor->visitIfExpr(this);
-          } else if (std::is_same_v<T, BlockExpr>) {
-            return visitor->visitBlockExpr(this);
-          } else if (std::is_same_v<T, ForExpr>) {
-            return visitor->visitForExpr(this);
-          } else if (std::is_same_v<T, WhileExpr>) {
-            return visitor->visitWhileExpr(this);
-          } else if (std::is_same_v<T, GetExpr>) {
-            return visitor->visitGetExpr(this);
-          } else if (std::is_same_v<T, CallExpr>) {
-            return visitor->visitCallExpr(this);
-          } else if (std::is_same_v<T, VoidExpr>) {
-            return visitor->visitVoidExpr(this);
-          }
-        },
-        innerExpr);
-  }
-  // Clone a pointer to this expression
-  [[nodiscard]] std::unique_ptr<Expr> clone() const noexcept {
-    return std::make_unique<Expr>(sourceLocation, type, innerExpr);
+  // Index of an alternative of the inner expression
+  template <typename T>
+  static constexpr size_t kIndex = AlternativeIndex<T, InnerExpr>::value;
+  template <typename R, typename Visitor>
+  // Visit the expression based on its inner type - a switch on the index, so
+  // the visitor's function is called directly
+  R accept(Visitor* visitor) {
+    static_assert(std::variant_size_v<InnerExpr> == 18,
+                  "Every kind of expression needs a case");
+    switch (innerExpr.index()) {
+      case kIndex<BinaryExpr>:
+        return visitor->visitBinaryExpr(this);
+      case kIndex<PrefixExpr>:
+        return visitor->visitPrefixExpr(this);
+      case kIndex<IntExpr>:
+        return visitor->visitIntExpr(this);
+      case kIndex<FloatExpr>:
+        return visitor->visitFloatExpr(this);
+      case kIndex<BoolExpr>:
+        return visitor->visitBoolExpr(this);
+      case kIndex<CharExpr>:
+        return visitor->visitCharExpr(this);
+      case kIndex<StringExpr*>:
+        return visitor->visitStringExpr(this);
+      case kIndex<LiteralExpr>:
+        return visitor->visitLiteralExpr(this);
+      case kIndex<FunctionExpr*>:
+        return visitor->visitFunctionExpr(this);
+      case kIndex<TypeConvExpr*>:
+        return visitor->visitTypeConvExpr(this);
+      case kIndex<MatchExpr*>:
+        return visitor->visitMatchExpr(this);
+      case kIndex<IfExpr>:
+        return visitor->visitIfExpr(this);
+      case kIndex<BlockExpr*>:
+        return visitor->visitBlockExpr(this);
+      case kIndex<ForExpr>:
+        return visitor->visitForExpr(this);
+      case kIndex<WhileExpr>:
+        return visitor->visitWhileExpr(this);
+      case kIndex<GetExpr>:
+        return visitor->visitGetExpr(this);
+      case kIndex<CallExpr*>:
+        return visitor->visitCallExpr(this);
+      default:
+        return visitor->visitVoidExpr(this);
+    }
   }
   // Make an expression of various types
-  static Expr makeBinary(const Token& op, std::shared_ptr<Type> type);
-  static Expr makePrefix(const Token& op, std::shared_ptr<Type> type);
-  static Expr makeInt(const Token& op, std::shared_ptr<Type> type, int num);
-  static Expr makeFloat(const Token& op, std::shared_ptr<Type> type,
-                        double num);
-  static Expr makeTypeConv(const SourceLocation& source_location,
+  static Expr makeBinary(const Token& op, const SourceLocation& location,
+                         std::shared_ptr<Type> type);
+  static Expr makePrefix(const Token& op, const SourceLocation& location,
+                         std::shared_ptr<Type> type);
+  static Expr makeInt(const SourceLocation& location,
+                      std::shared_ptr<Type> type, int num);
+  static Expr makeFloat(const SourceLocation& location,
+                        std::shared_ptr<Type> type, double num);
+  static Expr makeTypeConv(Arena* arena,
+                           const SourceLocation& source_location,
                            std::shared_ptr<Type> from,
                            std::shared_ptr<Type> to);
   // Return an expression of various types
@@ -333,25 +274,25 @@ struct Expr {
   }
 
   [[nodiscard]] StringExpr* getStringExpr() {
-    return &std::get<StringExpr>(innerExpr);
+    return std::get<StringExpr*>(innerExpr);
   }
   [[nodiscard]] LiteralExpr* getLiteralExpr() {
     return &std::get<LiteralExpr>(innerExpr);
   }
 
   [[nodiscard]] FunctionExpr* getFunctionExpr() {
-    return &std::get<FunctionExpr>(innerExpr);
+    return std::get<FunctionExpr*>(innerExpr);
   }
   [[nodiscard]] TypeConvExpr* getTypeConvExpr() {
-    return &std::get<TypeConvExpr>(innerExpr);
+    return std::get<TypeConvExpr*>(innerExpr);
   }
   [[nodiscard]] MatchExpr* getMatchExpr() {
-    return &std::get<MatchExpr>(innerExpr);
+    return std::get<MatchExpr*>(innerExpr);
   }
   [[nodiscard]] IfExpr* getIfExpr() { return &std::get<IfExpr>(innerExpr); }
 
   [[nodiscard]] BlockExpr* getBlockExpr() {
-    return &std::get<BlockExpr>(innerExpr);
+    return std::get<BlockExpr*>(innerExpr);
   }
   [[nodiscard]] ForExpr* getForExpr() { return &std::get<ForExpr>(innerExpr); }
   [[nodiscard]] WhileExpr* getWhileExpr() {
@@ -359,7 +300,7 @@ struct Expr {
   }
   [[nodiscard]] GetExpr* getGetExpr() { return &std::get<GetExpr>(innerExpr); }
   [[nodiscard]] CallExpr* getCallExpr() {
-    return &std::get<CallExpr>(innerExpr);
+    return std::get<CallExpr*>(innerExpr);
   }
 
   // Get the value of an int or float expr
@@ -370,173 +311,90 @@ struct Expr {
 
   // Check if expression is of various types
   [[nodiscard]] bool isBinaryExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, BinaryExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<BinaryExpr>(innerExpr);
   }
   [[nodiscard]] bool isPrefixExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, PrefixExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<PrefixExpr>(innerExpr);
   }
   [[nodiscard]] bool isIntExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, IntExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<IntExpr>(innerExpr);
   }
   [[nodiscard]] bool isFloatExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, FloatExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<FloatExpr>(innerExpr);
   }
   [[nodiscard]] bool isBoolExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, BoolExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<BoolExpr>(innerExpr);
   }
   [[nodiscard]] bool isCharExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, CharExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<CharExpr>(innerExpr);
   }
 
   [[nodiscard]] bool isStringExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, StringExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<StringExpr*>(innerExpr);
   }
   [[nodiscard]] bool isLiteralExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, LiteralExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<LiteralExpr>(innerExpr);
   }
 
   [[nodiscard]] bool isFunctionExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, FunctionExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<FunctionExpr*>(innerExpr);
   }
   [[nodiscard]] bool isTypeConvExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, TypeConvExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<TypeConvExpr*>(innerExpr);
   }
   [[nodiscard]] bool isMatchExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, MatchExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<MatchExpr*>(innerExpr);
   }
   [[nodiscard]] bool isIfExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, IfExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<IfExpr>(innerExpr);
   }
 
   [[nodiscard]] bool isBlockExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, BlockExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<BlockExpr*>(innerExpr);
   }
   [[nodiscard]] bool isForExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, ForExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<ForExpr>(innerExpr);
   }
   [[nodiscard]] bool isWhileExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, WhileExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<WhileExpr>(innerExpr);
   }
   [[nodiscard]] bool isGetExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, GetExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<GetExpr>(innerExpr);
   }
   [[nodiscard]] bool isCallExpr() const {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, CallExpr>;
-        },
-        innerExpr);
+    return std::holds_alternative<CallExpr*>(innerExpr);
   }
 
   // Default constructor
   Expr(const Expr& expr);
   Expr(Expr&& expr) noexcept;
   Expr(const SourceLocation& source_location, std::shared_ptr<Type> type,
-       const InnerExpr& inner_expr);
+       InnerExpr inner_expr);
   ~Expr();
 };
+// Print the bytes each kind of node takes, including out-of-line payloads
+void reportNodeSizes(std::ostream& out);
 
-template <typename T>
-// Visitor for an expression
+template <typename Derived, typename T>
+// Visitor for an expression - Derived supplies enterExprVisitor,
+// exitExprVisitor and a visit function for every kind of expression, which
+// are found at compile time rather than through a vtable
 struct ExprVisitor {
   // Visit an expression - return ans from accepting, if type is not void
   T visitExpr(Expr* expr) {
-    enterExprVisitor();
+    derived()->enterExprVisitor();
     if constexpr (std::is_same_v<T, void>) {
-      expr->accept(this);
-      exitExprVisitor();
+      expr->accept<T>(derived());
+      derived()->exitExprVisitor();
     } else {
-      T ans = expr->accept(this);
-      exitExprVisitor();
+      T ans = expr->accept<T>(derived());
+      derived()->exitExprVisitor();
       return ans;
     }
   }
-  T _visitExpr(Expr* expr) { return expr->accept(this); }
-  // Pure virtual functions
-  virtual void enterExprVisitor() = 0;
-  virtual void exitExprVisitor() = 0;
+  T _visitExpr(Expr* expr) { return expr->accept<T>(derived()); }
 
-  virtual T visitBinaryExpr(Expr* binaryExpr) = 0;
-  virtual T visitPrefixExpr(Expr* prefixExpr) = 0;
-  virtual T visitIntExpr(Expr* intExpr) = 0;
-  virtual T visitFloatExpr(Expr* floatExpr) = 0;
-  virtual T visitBoolExpr(Expr* boolExpr) = 0;
-  virtual T visitCharExpr(Expr* charExpr) = 0;
-  virtual T visitStringExpr(Expr* stringExpr) = 0;
-  virtual T visitLiteralExpr(Expr* literalExpr) = 0;
-  virtual T visitFunctionExpr(Expr* functionExpr) = 0;
-  virtual T visitTypeConvExpr(Expr* TypeConvExpr) = 0;
-  virtual T visitMatchExpr(Expr* matchExpr) = 0;
-  virtual T visitIfExpr(Expr* ifExpr) = 0;
-  virtual T visitBlockExpr(Expr* blockExpr) = 0;
-  virtual T visitForExpr(Expr* forExpr) = 0;
-  virtual T visitWhileExpr(Expr* whileExpr) = 0;
-  virtual T visitGetExpr(Expr* getExpr) = 0;
-  virtual T visitCallExpr(Expr* callExpr) = 0;
-  virtual T visitVoidExpr(Expr* callExpr) = 0;
+ private:
+  Derived* derived() { return static_cast<Derived*>(this); }
 };
 #endif  // INCLUDE_SRC_EXPR_H_
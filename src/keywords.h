@@ -0,0 +1,107 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_KEYWORDS_H_
+#define INCLUDE_SRC_KEYWORDS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "token.h"
+// Reserved word and the token it lexes to
+struct Keyword {
+  std::string_view text;
+  TOKEN_TYPE type;
+};
+// Every reserved word - adding a keyword only needs a new entry here, the
+// perfect hash below is regenerated at compile time
+inline constexpr Keyword keywords[] = {
+    {"case", TOKEN_TYPE::CASE},         {"class", TOKEN_TYPE::CLASS},
+    {"const", TOKEN_TYPE::CONST},       {"continue", TOKEN_TYPE::CONTINUE},
+    {"else", TOKEN_TYPE::ELSE},         {"false", TOKEN_TYPE::FALSE},
+    {"fn", TOKEN_TYPE::FN},             {"for", TOKEN_TYPE::FOR},
+    {"if", TOKEN_TYPE::IF},             {"impl", TOKEN_TYPE::IMPL},
+    {"in", TOKEN_TYPE::IN},             {"let", TOKEN_TYPE::LET},
+    {"list", TOKEN_TYPE::LIST},         {"match", TOKEN_TYPE::MATCH},
+    {"optional", TOKEN_TYPE::OPTIONAL}, {"return", TOKEN_TYPE::RETURN},
+    {"self", TOKEN_TYPE::SELF},         {"true", TOKEN_TYPE::TRUE},
+    {"type", TOKEN_TYPE::TYPE},         {"void", TOKEN_TYPE::VOID},
+    {"while", TOKEN_TYPE::WHILE},       {"yield", TOKEN_TYPE::YIELD},
+};
+
+// Shortest and longest keyword - anything outside is an identifier unhashed
+consteval size_t keywordLength(bool longest) {
+  size_t result = keywords[0].text.size();
+  for (const Keyword& keyword : keywords) {
+    size_t size = keyword.text.size();
+    if (longest ? size > result : size < result) result = size;
+  }
+  return result;
+}
+inline constexpr size_t kKeywordMinLength = keywordLength(false);
+inline constexpr size_t kKeywordMaxLength = keywordLength(true);
+static_assert(kKeywordMinLength >= 2, "keyword key reads two characters");
+static_assert(kKeywordMaxLength < 256, "keyword key stores length in 8 bits");
+
+// Hash table is indexed by the top bits of key * seed
+inline constexpr size_t kKeywordBits = 6;
+inline constexpr size_t kKeywordSlots = size_t{1} << kKeywordBits;
+static_assert(std::size(keywords) <= kKeywordSlots, "keyword table is full");
+// Pack first, second and last character with the length of a word
+constexpr uint32_t keywordKey(std::string_view word) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(word[0])) |
+         static_cast<uint32_t>(static_cast<unsigned char>(word[1])) << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(word.back())) << 16 |
+         static_cast<uint32_t>(word.size()) << 24;
+}
+constexpr size_t keywordSlot(uint32_t key, uint32_t seed) {
+  return static_cast<uint32_t>(key * seed) >> (32 - kKeywordBits);
+}
+// Find an odd multiplier that sends every keyword to its own slot
+consteval uint32_t findKeywordSeed() {
+  for (uint32_t seed = 0x9E3779B1u;; seed += 2) {
+    std::array<bool, kKeywordSlots> used{};
+    bool collides = false;
+    for (const Keyword& keyword : keywords) {
+      size_t slot = keywordSlot(keywordKey(keyword.text), seed);
+      if (used[slot]) {
+        collides = true;
+        break;
+      }
+      used[slot] = true;
+    }
+    if (!collides) return seed;
+  }
+}
+inline constexpr uint32_t kKeywordSeed = findKeywordSeed();
+// Keyword stored in each slot; empty slots have empty text and never match
+consteval std::array<Keyword, kKeywordSlots> buildKeywordTable() {
+  std::array<Keyword, kKeywordSlots> table{};
+  for (const Keyword& keyword : keywords) {
+    table[keywordSlot(keywordKey(keyword.text), kKeywordSeed)] = keyword;
+  }
+  return table;
+}
+inline constexpr std::array<Keyword, kKeywordSlots> kKeywordTable =
+    buildKeywordTable();
+
+// Return the keyword token for an identifier, or IDEN if it is not reserved
+constexpr TOKEN_TYPE keywordType(std::string_view word) {
+  if (word.size() < kKeywordMinLength || word.size() > kKeywordMaxLength) {
+    return TOKEN_TYPE::IDEN;
+  }
+  const Keyword& keyword =
+      kKeywordTable[keywordSlot(keywordKey(word), kKeywordSeed)];
+  return keyword.text == word ? keyword.type : TOKEN_TYPE::IDEN;
+}
+// Every keyword must find itself
+consteval bool keywordTableComplete() {
+  for (const Keyword& keyword : keywords) {
+    if (keywordType(keyword.text) != keyword.type) return false;
+  }
+  return true;
+}
+static_assert(keywordTableComplete(), "keyword hash is not perfect");
+static_assert(keywordType("lets") == TOKEN_TYPE::IDEN);
+
+#endif  // INCLUDE_SRC_KEYWORDS_H_
@@ -1,21 +1,15 @@
 // Copyright (c) 2024 Compile Collective. All Rights Reserved.
 #include "lexer.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+#include "keywords.h"
+#include "scan.h"
 #include "token.h"
 
-// Skip whitespace - increase line or position if necessary
-void Lexer::skipWhitespace() {
-  while (pos < input.size() &&
-         (input.at(pos) == ' ' || input.at(pos) == '\t' ||
-          input.at(pos) == '\r' || input.at(pos) == '\n')) {
-    ++curr.character;
-    if (input.at(pos) == '\n') {
-      ++curr.line;
-      curr.character = 1;
-    }
-    ++pos;
-  }
-}
 // Returns true if character is a-z, A-Z, or an underscore
 bool isAlpha(const char t) {
   return t == '_' || (t >= 'a' && t <= 'z') || (t >= 'A' && t <= 'Z');
@@ -31,25 +25,51 @@ bool isEscapeSequence(const char t) {
 bool isHex(const char t) {
   return isNumeric(t) || (t >= 'a' && t <= 'f') || (t >= 'A' && t <= 'F');
 }
+// Returns true if a character is skipped as whitespace
+bool isWhitespace(const char t) {
+  return t == ' ' || t == '\t' || t == '\r' || t == '\n';
+}
+// Returns true if a character can continue an identifier
+bool isIdentifier(const char t) { return isAlpha(t) || isNumeric(t); }
+// Runs up to this long are scanned inline; the vector kernels only pay for
+// their call once a run fills a whole block
+constexpr size_t kInlineRun = 16;
+// Length of the run of characters matching pred at the start of text
+template <bool (*pred)(const char)>
+static size_t runLength(const char* text, size_t len,
+                        size_t (*kernel)(const char*, size_t)) {
+  size_t limit = len < kInlineRun ? len : kInlineRun;
+  for (size_t i = 0; i < limit; ++i) {
+    if (!pred(text[i])) return i;
+  }
+  return limit + kernel(text + limit, len - limit);
+}
+// Skip whitespace - lines and columns are left to the SourceMap
+void Lexer::skipWhitespace() {
+  pos += runLength<isWhitespace>(input.data() + pos, input.size() - pos,
+                                 scan->whitespace);
+}
 // Tokenize the next character
 Token Lexer::next() {
   // Whitespace is ignored
   skipWhitespace();
   // End of file reached; final token
-  if (pos >= input.size()) return Token{TOKEN_TYPE::FILE_END, "", curr};
+  if (pos >= input.size()) {
+    return Token{static_cast<uint32_t>(pos), 0, TOKEN_TYPE::FILE_END};
+  }
   // Store length of current token
   size_t len = 1;
   // Assume error by default
   TOKEN_TYPE type = TOKEN_TYPE::ERROR;
   // Decide token based on characters in input
-  switch (input.at(pos)) {
+  switch (input[pos]) {
     case '+':
       type = TOKEN_TYPE::PLUS;
       break;
     case '-':
       type = TOKEN_TYPE::MINUS;
       // -> is arrow
-      if (pos + len < input.size() && input.at(pos + len) == '>') {
+      if (pos + len < input.size() && input[pos + len] == '>') {
         ++len;
         type = TOKEN_TYPE::ARROW;
       }
@@ -78,7 +98,7 @@ Token Lexer::next() {
     case '!':
       type = TOKEN_TYPE::NOT;
       // != is not equals
-      if (pos + len < input.size() && input.at(pos + len) == '=') {
+      if (pos + len < input.size() && input[pos + len] == '=') {
         ++len;
         type = TOKEN_TYPE::NEQUALS;
       }
@@ -112,25 +132,23 @@ Token Lexer::next() {
     case '8':
     case '9':
       // Entire number is one token
-      while (pos + len < input.size() && isNumeric(input.at(pos + len))) {
-        ++len;
-      }
+      len += runLength<isNumeric>(input.data() + pos + len,
+                                  input.size() - pos - len, scan->digits);
       // Assume integer - if next token is . followed by another number, then it is a float
       type = TOKEN_TYPE::INT;
-      if (pos + len + 1 < input.size() && input.at(pos + len) == '.' &&
-          isNumeric(input.at(pos + len + 1))) {
+      if (pos + len + 1 < input.size() && input[pos + len] == '.' &&
+          isNumeric(input[pos + len + 1])) {
         type = TOKEN_TYPE::FLOAT;
         len += 2;
-      }
-      while (pos + len < input.size() && isNumeric(input.at(pos + len))) {
-        ++len;
+        len += runLength<isNumeric>(input.data() + pos + len,
+                                    input.size() - pos - len, scan->digits);
       }
       break;
     case '<':
       type = TOKEN_TYPE::LANGLE;
       if (pos + len >= input.size()) break;
       // <= is less than or equal to, << is left shift
-      switch (input.at(pos + len)) {
+      switch (input[pos + len]) {
         case '=':
           ++len;
           type = TOKEN_TYPE::LEQ;
@@ -144,7 +162,7 @@ Token Lexer::next() {
     case '>':
       type = TOKEN_TYPE::RANGLE;
       if (pos + len >= input.size()) break;
-      switch (input.at(pos + len)) {
+      switch (input[pos + len]) {
         // >= is greater than or equal to, >> is right shift
         case '=':
           ++len;
@@ -159,7 +177,7 @@ Token Lexer::next() {
     case '&':
       type = TOKEN_TYPE::BITAND;
       // && is logical AND
-      if (pos + len < input.size() && input.at(pos + len) == '&') {
+      if (pos + len < input.size() && input[pos + len] == '&') {
         ++len;
         type = TOKEN_TYPE::AND;
       }
@@ -167,7 +185,7 @@ Token Lexer::next() {
     case '=':
       type = TOKEN_TYPE::ASSIGN;
       // == is the equality operator
-      if (pos + len < input.size() && input.at(pos + len) == '=') {
+      if (pos + len < input.size() && input[pos + len] == '=') {
         ++len;
         type = TOKEN_TYPE::EQUALS;
       }
@@ -175,7 +193,7 @@ Token Lexer::next() {
     case '|':
       type = TOKEN_TYPE::BITOR;
       // || is logical OR
-      if (pos + len < input.size() && input.at(pos + len) == '|') {
+      if (pos + len < input.size() && input[pos + len] == '|') {
         ++len;
         type = TOKEN_TYPE::OR;
       }
@@ -183,11 +201,11 @@ Token Lexer::next() {
     case '.':
       type = TOKEN_TYPE::DOT;
       // .. is range
-      if (pos + len < input.size() && input.at(pos + len) == '.') {
+      if (pos + len < input.size() && input[pos + len] == '.') {
         ++len;
         type = TOKEN_TYPE::RANGE;
         // ..= is inclusive range
-        if (pos + len < input.size() && input.at(pos + len) == '=') {
+        if (pos + len < input.size() && input[pos + len] == '=') {
           ++len;
           type = TOKEN_TYPE::INCRANGE;
         }
@@ -195,160 +213,229 @@ Token Lexer::next() {
       break;
     case '"':
       ++len;
-      // String includes all text between "'s
-      while (pos + len < input.size()) {
-        ++len;
-        if (input.at(pos + len - 1) == '"') {
+      // String includes all text between "'s (the closing quote is searched
+      // for from the second character of the body on)
+      if (pos + len < input.size()) {
+        size_t body = input.size() - pos - len;
+        size_t quote = scan->quote(input.data() + pos + len, body);
+        if (quote < body) {
+          len += quote + 1;
           type = TOKEN_TYPE::STRING;
-          break;
         }
       }
       break;
     case '\'':
       // Character is between ''s (empty character)
-      if (pos + len < input.size() && input.at(pos + len) == '\'') {
+      if (pos + len < input.size() && input[pos + len] == '\'') {
         ++len;
         type = TOKEN_TYPE::CHAR;
         break;
       }
       // Regular character
-      if (pos + len + 1 < input.size() && input.at(pos + len) != '\\' &&
-          input.at(pos + len + 1) == '\'') {
+      if (pos + len + 1 < input.size() && input[pos + len] != '\\' &&
+          input[pos + len + 1] == '\'') {
         len += 2;
         type = TOKEN_TYPE::CHAR;
         break;
       }
       // Escape sequence character
-      if (pos + len + 2 < input.size() && input.at(pos + len) == '\\' &&
-          isEscapeSequence(input.at(pos + len + 1)) &&
-          input.at(pos + len + 2) == '\'') {
+      if (pos + len + 2 < input.size() && input[pos + len] == '\\' &&
+          isEscapeSequence(input[pos + len + 1]) &&
+          input[pos + len + 2] == '\'') {
         len += 3;
         type = TOKEN_TYPE::CHAR;
         break;
       }
       // '\xHH' where H is a hex digit is a character (defines ASCII)
-      if (pos + len + 4 < input.size() && input.at(pos + len) == '\\' &&
-          input.at(pos + len + 1) == 'x' && isHex(input.at(pos + len + 2)) &&
-          isHex(input.at(pos + len + 3)) && input.at(pos + len + 4) == '\'') {
+      if (pos + len + 4 < input.size() && input[pos + len] == '\\' &&
+          input[pos + len + 1] == 'x' && isHex(input[pos + len + 2]) &&
+          isHex(input[pos + len + 3]) && input[pos + len + 4] == '\'') {
         len += 5;
         type = TOKEN_TYPE::CHAR;
         break;
       }
     default:
       // If none of the above, and not alphabetical (a-z, A-Z, or _), input is not a valid token
-      if (!isAlpha(input.at(pos))) break;
+      if (!isAlpha(input[pos])) break;
       // If the first character is alphabetical (including _), this is an identifier - add any subsequent alphabetical or numeric characters to it
-      while (pos + len < input.size() &&
-             (isAlpha(input.at(pos + len)) || isNumeric(input.at(pos + len)))) {
-        ++len;
-      }
-      type = TOKEN_TYPE::IDEN;
+      len += runLength<isIdentifier>(input.data() + pos + len,
+                                     input.size() - pos - len,
+                                     scan->identifier);
       // Check for built-in identifiers (if none apply, remain an IDEN, i.e., a variable name)
-      switch (input.at(pos)) {
-        // case, const, continue, class
-        case 'c':
-          if (len == 4 && input.substr(pos + 1, len - 1) == "ase") {
-            type = TOKEN_TYPE::CASE;
-          } else if (len == 5 && input.substr(pos + 1, len - 1) == "onst") {
-            type = TOKEN_TYPE::CONST;
-          } else if (len == 8 && input.substr(pos + 1, len - 1) == "ontinue") {
-            type = TOKEN_TYPE::CONTINUE;
-          } else if (len == 5 && input.substr(pos + 1, len - 1) == "lass") {
-            type = TOKEN_TYPE::CLASS;
-          }
-          break;
-        // else
-        case 'e':
-          if (len == 4 && input.substr(pos + 1, len - 1) == "lse") {
-            type = TOKEN_TYPE::ELSE;
-          }
-          break;
-        // fn, false, for
-        case 'f':
-          if (len == 2 && input.at(pos + 1) == 'n') {
-            type = TOKEN_TYPE::FN;
-          } else if (len == 5 && input.substr(pos + 1, len - 1) == "alse") {
-            type = TOKEN_TYPE::FALSE;
-          } else if (len == 3 && input.substr(pos + 1, len - 1) == "or") {
-            type = TOKEN_TYPE::FOR;
-          }
-          break;
-        // if, in, impl
-        case 'i':
-          if (len == 2 && input.at(pos + 1) == 'f') {
-            type = TOKEN_TYPE::IF;
-          } else if (len == 2 && input.at(pos + 1) == 'n') {
-            type = TOKEN_TYPE::IN;
-          } else if (len == 4 && input.substr(pos + 1, len - 1) == "mpl") {
-            type = TOKEN_TYPE::IMPL;
-          }
-          break;
-        // let, list
-        case 'l':
-          if (len == 3 && input.substr(pos + 1, len - 1) == "et") {
-            type = TOKEN_TYPE::LET;
-          }
-          if (len == 4 && input.substr(pos + 1, len - 1) == "ist") {
-            type = TOKEN_TYPE::LIST;
-          }
-          break;
-        // match
-        case 'm':
-          if (len == 5 && input.substr(pos + 1, len - 1) == "atch") {
-            type = TOKEN_TYPE::MATCH;
-          }
-          break;
-        // optional
-        case 'o':
-          if (len == 8 && input.substr(pos + 1, len - 1) == "ptional") {
-            type = TOKEN_TYPE::OPTIONAL;
-          }
-          break;
-        // return
-        case 'r':
-          if (len == 6 && input.substr(pos + 1, len - 1) == "eturn") {
-            type = TOKEN_TYPE::RETURN;
-          }
-          break;
-        // self
-        case 's':
-          if (len == 4 && input.substr(pos + 1, len - 1) == "elf") {
-            type = TOKEN_TYPE::SELF;
-          }
-          break;
-        // true, type
-        case 't':
-          if (len == 4 && input.substr(pos + 1, len - 1) == "rue") {
-            type = TOKEN_TYPE::TRUE;
-          } else if (len == 4 && input.substr(pos + 1, len - 1) == "ype") {
-            type = TOKEN_TYPE::TYPE;
-          }
-          break;
-        // void
-        case 'v':
-          if (len == 4 && input.substr(pos + 1, len - 1) == "oid") {
-            type = TOKEN_TYPE::VOID;
-          }
-          break;
-        // while
-        case 'w':
-          if (len == 5 && input.substr(pos + 1, len - 1) == "hile") {
-            type = TOKEN_TYPE::WHILE;
-          }
-          break;
-        // yield
-        case 'y':
-          if (len == 5 && input.substr(pos + 1, len - 1) == "ield") {
-            type = TOKEN_TYPE::YIELD;
-          }
-          break;
-      }
+      type = keywordType(input.substr(pos, len));
   }
   // If no valid token has been set, return an error
-  if (type == TOKEN_TYPE::ERROR) return Token{type, "Invalid Character.", curr};
+  if (type == TOKEN_TYPE::ERROR) {
+    return Token{static_cast<uint32_t>(pos), 0, type};
+  }
   // Create the valid token, update position, and return the token
-  auto returner = Token{type, input.substr(pos, len), curr};
+  auto returner =
+      Token{static_cast<uint32_t>(pos), static_cast<uint16_t>(len), type};
+  if (len >= Token::kLongToken) {
+    returner.length = Token::kLongToken;
+    map->addLongToken(returner.offset, len);
+  }
   pos += len;
-  curr.character += len;
   return returner;
 }
+// Lex the rest of the input in one go
+std::vector<Token> Lexer::tokenize() {
+  std::vector<Token> tokens;
+  // Most tokens are a few characters plus a space
+  tokens.reserve((input.size() - pos) / 4 + 1);
+  do {
+    tokens.push_back(next());
+  } while (tokens.back().type != TOKEN_TYPE::FILE_END &&
+           tokens.back().type != TOKEN_TYPE::ERROR);
+  return tokens;
+}
+// Parallel lexing only pays off with at least this much input per thread
+constexpr size_t kMinParallelChunk = 1 << 20;
+// Returns true if no token follows this one
+static bool isLastToken(const Token& token) {
+  return token.type == TOKEN_TYPE::FILE_END || token.type == TOKEN_TYPE::ERROR;
+}
+// Each worker lexes its chunk as if a token started there, which is wrong
+// when the chunk starts inside a string or character. The lexer only depends
+// on its position, so once the true token stream lands on a token a worker
+// found, the rest of that worker's tokens are right. Stitching lexes serially
+// from the end of each chunk until that happens - usually straight away
+std::vector<Token> Lexer::tokenizeParallel(unsigned threads) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t size = input.size() - pos;
+  threads = static_cast<unsigned>(
+      std::min<size_t>(threads, size / kMinParallelChunk));
+  if (threads <= 1) return tokenize();
+  // Chunk i covers tokens starting in [starts[i], starts[i + 1]); cuts are
+  // moved past a newline, where tokens other than strings never continue
+  std::vector<size_t> starts{pos};
+  for (unsigned i = 1; i < threads; ++i) {
+    size_t cut = input.find('\n', std::max(pos + size / threads * i,
+                                            starts.back()));
+    if (cut == std::string_view::npos) break;
+    starts.push_back(cut + 1);
+  }
+  // The last chunk runs to the end of the file
+  starts.push_back(std::numeric_limits<size_t>::max());
+  size_t chunks = starts.size() - 1;
+  std::vector<std::vector<Token>> found(chunks);
+  auto lexChunk = [&](size_t i) {
+    Lexer lexer(map, starts[i]);
+    found[i].reserve((std::min(starts[i + 1], input.size()) - starts[i]) / 4);
+    for (;;) {
+      Token token = lexer.next();
+      if (token.offset >= starts[i + 1]) break;
+      found[i].push_back(token);
+      if (isLastToken(token)) break;
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < chunks; ++i) workers.emplace_back(lexChunk, i);
+  lexChunk(0);
+  for (auto& worker : workers) worker.join();
+
+  // Stitch serially - chunk i gets the tokens lexed before its worker's came
+  // into sync, then its worker's tokens from that point on
+  std::vector<std::vector<Token>> bridges(chunks);
+  std::vector<size_t> from(chunks);
+  for (size_t i = 0; i < chunks; ++i) from[i] = found[i].size();
+  size_t used = chunks;
+  Lexer serial(map, pos);
+  Token want = serial.next();  // The true next token
+  for (size_t i = 0; i < used; ++i) {
+    const auto& chunk = found[i];
+    bool done = false;
+    while (!done && want.offset < starts[i + 1]) {
+      auto match = std::lower_bound(
+          chunk.begin(), chunk.end(), want.offset,
+          [](const Token& token, uint32_t offset) {
+            return token.offset < offset;
+          });
+      if (match != chunk.end() && match->offset == want.offset) {
+        // In sync - take the rest of the chunk and lex past its end
+        from[i] = match - chunk.begin();
+        done = isLastToken(chunk.back());
+        if (done) break;
+        serial.pos = chunk.back().offset + map->text(chunk.back()).size();
+        want = serial.next();
+        break;
+      }
+      bridges[i].push_back(want);
+      done = isLastToken(want);
+      if (!done) want = serial.next();
+    }
+    if (done) used = i + 1;
+  }
+  // Copy the pieces into place, again one chunk per thread
+  std::vector<size_t> at(used + 1, 0);
+  for (size_t i = 0; i < used; ++i) {
+    at[i + 1] = at[i] + bridges[i].size() + found[i].size() - from[i];
+  }
+  std::vector<Token> tokens(at[used]);
+  auto copyChunk = [&](size_t i) {
+    auto out = std::copy(bridges[i].begin(), bridges[i].end(),
+                         tokens.begin() + at[i]);
+    std::copy(found[i].begin() + from[i], found[i].end(), out);
+  };
+  workers.clear();
+  for (size_t i = 1; i < used; ++i) workers.emplace_back(copyChunk, i);
+  copyChunk(0);
+  for (auto& worker : workers) worker.join();
+  // Stop where tokenize() would have
+  pos = tokens.back().offset;
+  return tokens;
+}
+// The lexer looks at most this many characters past the end of a token (a
+// digit after "1." decides between INT and FLOAT)
+constexpr size_t kLookahead = 2;
+// Tokens that ended, with the characters the lexer looked at after them,
+// before the edit are kept. As in tokenizeParallel(), lexing only depends on
+// position, so once a new token starts where a moved old one does, past the
+// inserted text, the rest of the old tokens are right
+TokenEdit Lexer::relex(const std::shared_ptr<SourceMap>& map,
+                       std::vector<Token>& tokens, size_t offset,
+                       size_t removed, size_t inserted) {
+  auto end = [&](const Token& token) {
+    return token.offset + map->text(token).size();
+  };
+  // The last token is always lexed again, as an error stops the lexer early
+  size_t first = std::partition_point(tokens.begin(), tokens.end() - 1,
+                                      [&](const Token& token) {
+                                        return token.offset < offset &&
+                                               end(token) + kLookahead <=
+                                                   offset;
+                                      }) -
+                 tokens.begin();
+  int64_t delta = static_cast<int64_t>(inserted) - removed;
+  std::vector<Token> fresh;
+  Lexer lexer(map, first == 0 ? 0 : end(tokens[first - 1]));
+  size_t kept = first;  // Next old token that may be back in step
+  for (;;) {
+    Token token = lexer.next();
+    if (token.offset >= offset + inserted) {
+      while (kept < tokens.size() &&
+             (tokens[kept].offset < offset + removed ||
+              tokens[kept].offset + delta < token.offset)) {
+        ++kept;
+      }
+      if (kept < tokens.size() && tokens[kept].offset + delta == token.offset) {
+        break;
+      }
+    }
+    fresh.push_back(token);
+    if (isLastToken(token)) {
+      kept = tokens.size();
+      break;
+    }
+  }
+  for (size_t at = kept; at < tokens.size(); ++at) {
+    tokens[at].offset = static_cast<uint32_t>(tokens[at].offset + delta);
+  }
+  // Put the new tokens in place of the old ones
+  size_t common = std::min(fresh.size(), kept - first);
+  std::copy(fresh.begin(), fresh.begin() + common, tokens.begin() + first);
+  tokens.erase(tokens.begin() + first + common, tokens.begin() + kept);
+  tokens.insert(tokens.begin() + first + common, fresh.begin() + common,
+                fresh.end());
+  return TokenEdit{first, kept, first + fresh.size()};
+}
@@ -3,30 +3,65 @@
 #define INCLUDE_SRC_LEXER_H_
 
 #include <cstddef>
+#include <memory>
 #include <string_view>
+#include <vector>
 
 #include "common.h"
+#include "scan.h"
+#include "source_map.h"
 #include "token.h"
+// Where tokens changed after an edit - old tokens [first, oldEnd) are now
+// tokens [first, newEnd), and the ones after them moved along
+struct TokenEdit {
+  size_t first = 0;
+  size_t oldEnd = 0;
+  size_t newEnd = 0;
+};
 // Lexer class - tokenize input
 class Lexer {
  public:
   // Copy, destructor, and constructor operations
   explicit Lexer(const std::string_view input)
-      : input(input), curr{1, 1}, pos{0} {}
+      : input(input),
+        pos{0},
+        scan(&scanKernels()),
+        map(std::make_shared<SourceMap>(input)) {}
   Lexer(Lexer&& lexer) noexcept
-      : input(lexer.input), curr(lexer.curr), pos(lexer.pos) {}
+      : input(lexer.input), pos(lexer.pos), scan(lexer.scan), map(lexer.map) {}
   Lexer(const Lexer& lexer)
-      : input(lexer.input), curr(lexer.curr), pos(lexer.pos) {}
+      : input(lexer.input), pos(lexer.pos), scan(lexer.scan), map(lexer.map) {}
   ~Lexer() = default;
 
   // Return the next token
   Token next();
+  // Return every remaining token, ending with the file end or the first error
+  std::vector<Token> tokenize();
+  // As above, lexing chunks of the input on worker threads (0 means one per
+  // core). Small inputs are lexed on this thread
+  std::vector<Token> tokenizeParallel(unsigned threads = 0);
+  // Return the map for the text and locations of this lexer's tokens
+  const std::shared_ptr<SourceMap>& sourceMap() const { return map; }
+  // Bring tokens of map's input up to date after map->edit(offset, removed,
+  // text), lexing only the ones near the edit again; return where they changed
+  static TokenEdit relex(const std::shared_ptr<SourceMap>& map,
+                         std::vector<Token>& tokens, size_t offset,
+                         size_t removed, size_t inserted);
 
  private:
-  // Store the input, current position, and source location
+  // Lex from a position of an input another lexer has mapped
+  Lexer(std::shared_ptr<SourceMap> map, size_t pos)
+      : input(map->source()),
+        pos{pos},
+        scan(&scanKernels()),
+        map(std::move(map)) {}
+  // Store the input and current position
   const std::string_view input;  // Non-owning reference to data
-  SourceLocation curr;
   size_t pos;
+  // Run scanners for the running CPU
+  const ScanKernels* scan;
+  // Shared with copies of this lexer and the parser
+  std::shared_ptr<SourceMap> map;
   void skipWhitespace();
 };
 
@@ -11,24 +11,20 @@
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/TargetParser/Host.h>
 
-#include <fstream>
-#include <sstream>
 // #include "PostFixExprVisualizer.h"
 // #include "codegen.h"
 #include <iostream>
+#include <string_view>
 #include <vector>
 
 #include "lexer.h"
+#include "source_buffer.h"
 #include "token.h"
 #include "parser.h"
 #include "type_checker.h"
 #include "codegen.h"
-std::string readFile(const char* path) {
-  std::ifstream file(path);
-  std::stringstream ss;
-  ss << file.rdbuf();
-  return ss.str();
-}
+#include "resolver.h"
+#include "type_resolver.h"
  /*
 void createMain(LLVMContext* context, Module* module, IRBuilder<>* builder,
                 Value* val) {
@@ -96,19 +92,35 @@ void writeModuleToFile(
 }
 // Main method (entry point, used for testing)
 int main(int argc, char* argv[]) {
+  // Layout report for the AST
+  if (argc == 2 && std::string_view{argv[1]} == "--node-sizes") {
+    reportNodeSizes(std::cout);
+    return 0;
+  }
+  // Hits and misses of the type caches, once the program is checked
+  bool cacheStats =
+      argc == 4 && std::string_view{argv[1]} == "--type-cache-stats";
+  if (cacheStats) {
+    --argc;
+    ++argv;
+  }
   if (argc != 3) return 255;
-  std::string input = readFile(argv[1]);
-  Parser parser{Lexer{input}};
-  auto env = parser.parse();
-  TypeChecker type_checker{env.get()};
-  type_checker.visit();
+  // Mapped (or read) once, "-" is stdin; must outlive everything that lexes
+  SourceBuffer input{argv[1]};
+  Parser parser{Lexer{input.view()}};
+  auto env = parser.parseParallel();
+  TypeResolver{env}.resolve();
+  Resolver{env}.resolve();
+  TypeChecker type_checker{env};
+  type_checker.visitParallel();
+  if (cacheStats) env->types->reportCacheStats(std::cout);
 
   llvm::LLVMContext
       context;  // Based off https://layle.me/posts/using-llvm-with-cmake/
   llvm::IRBuilder builder(context);
   const auto module = std::make_unique<llvm::Module>("first type", context);
-  CodeGen code_gen(env.get(), &context, &builder, module.get());
-  llvm::Value* val = code_gen.visitDeclarationStmt(env->getMember("main"));
+  CodeGen code_gen(env, &context, &builder, module.get());
+  llvm::Value* val = code_gen.visitDeclarationStmt(env->getMember(Symbol{"main"}));
   module->dump();
   writeModuleToFile(module.get(), argv[2]);
   return 0;
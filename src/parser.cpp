@@ -2,13 +2,17 @@
 #include "parser.h"
 
 
+#include <algorithm>
 #include <charconv>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "environment.h"
@@ -17,73 +21,511 @@
 #include "types.h"
 // Set up the parser
 void Parser::setup() {
-  program = std::make_unique<Environment>();
+  program = arena->make<Environment>(arena);
+  program->types = ownedTypes.get();
   // Pointers to each bottom type
-  program->bottomTypes.intType = std::make_shared<Type>(
-      BottomType::INT, std::vector<std::shared_ptr<Impl>>{});
-  program->bottomTypes.charType = std::make_shared<Type>(
-      BottomType::CHAR, std::vector<std::shared_ptr<Impl>>{});
-  program->bottomTypes.boolType = std::make_shared<Type>(
-      BottomType::BOOL, std::vector<std::shared_ptr<Impl>>{});
-  program->bottomTypes.floatType = std::make_shared<Type>(
-      BottomType::FLOAT, std::vector<std::shared_ptr<Impl>>{});
-  program->bottomTypes.voidType = std::make_shared<Type>(
-      BottomType::VOID, std::vector<std::shared_ptr<Impl>>{});
-  program->bottomTypes.selfType = std::make_shared<Type>(
-      BottomType::SELF, std::vector<std::shared_ptr<Impl>>{});
+  program->bottomTypes.intType = ownedTypes->bottom(BottomType::INT);
+  program->bottomTypes.charType = ownedTypes->bottom(BottomType::CHAR);
+  program->bottomTypes.boolType = ownedTypes->bottom(BottomType::BOOL);
+  program->bottomTypes.floatType = ownedTypes->bottom(BottomType::FLOAT);
+  program->bottomTypes.voidType = ownedTypes->bottom(BottomType::VOID);
+  program->bottomTypes.selfType = ownedTypes->bottom(BottomType::SELF);
+}
+// Return the token k places after the current one - the final token (file
+// end or an error) repeats forever, as the lexer would
+const Token& Parser::peek(size_t k) const {
+  size_t at = std::min(index + k, tokens->size() - 1);
+  furthest = std::max(furthest, at);
+  return (*tokens)[at];
+}
+// Return the text of the current token
+std::string_view Parser::text() const { return source->text(curr); }
+// Return the text of the current token, interned
+Symbol Parser::symbol() const { return Symbol{text()}; }
+// Return the line and column of the current token
+SourceLocation Parser::location() {
+  return source->locate(curr.offset, lineHint);
+}
+// Return member with name if it exists - in the open scopes, then outside
+// them; with a table of globals, as on a worker thread, globals are found
+// there, if defined before the one being parsed
+Stmt* Parser::lookup(Symbol name) {
+  if (Stmt* local = scopes.find(name)) return local;
+  if (!globalTable) return scopes.outer(program)->getMember(name);
+  auto found = globalTable->find(name);
+  if (found == globalTable->end() || found->second.first >= globalIndex) {
+    return nullptr;
+  }
+  return found->second.second;
+}
+// Return an environment nested in the current one, in this parser's arena,
+// and open its scope
+Environment* Parser::innerEnvironment() {
+  Environment* inner =
+      arena->make<Environment>(arena, program, program->bottomTypes);
+  scopes.push(inner);
+  return inner;
+}
+// Close the scope of the current environment, and go back to prev
+void Parser::outerEnvironment(Environment* prev) {
+  scopes.pop();
+  program = prev;
+}
+// Add a member to the current environment, and to its scope
+void Parser::declare(Symbol name, Stmt member) {
+  if (program->addMember(name, std::move(member))) {
+    scopes.bind(name, static_cast<uint32_t>(program->members.size() - 1));
+  }
+}
+// Move on to the next token
+void Parser::advance() {
+  if (index + 1 < tokens->size()) ++index;
+  curr = (*tokens)[index];
 }
 // Returns true if next token is of a certain type
 bool Parser::requireNext(TOKEN_TYPE type) {
-  Lexer lex = lexer;
-  if (lex.next().type != type) {
+  if (peek().type != type) {
     return false;
   }
-  curr = lexer.next();
+  advance();
   return true;
 }
 // Require token to be of a certain type, then move on to next token
 bool Parser::munch(TOKEN_TYPE type) {
   if (!requireNext(type)) return false;
-  curr = lexer.next();
+  advance();
   return true;
 }
 bool Parser::eatCurr(TOKEN_TYPE type) {
   if(curr.type != type) return false;
-  curr = lexer.next();
+  advance();
   return true;
 }
 // Parse based on type, and return environment
-std::unique_ptr<Environment> Parser::parse(Parser::parser is) {
-  curr = lexer.next();
+Environment* Parser::parse(Parser::parser is) {
+  index = 0;
+  curr = (*tokens)[index];
   // Handle a program parser, until file end
   if (is == parser::PROGRAM) {
     while (curr.type != TOKEN_TYPE::FILE_END) {
-      // Ensure all global statements are valid, and add them to the environment
-      auto global = globals();
-      if (!global) continue;
-      auto nameOfGlobal = global->getName();
-      if (program->members.find(nameOfGlobal) != program->members.end()) {
-        std::cerr << "Redefinition of existing global.";
-      }
-      program->addMember(nameOfGlobal, std::move(global.value()));
+      size_t first = index;
+      addGlobal(globals(), first);
     }
-    return std::move(program);
+    return program;
     // Handle type parser, add to program
   } else if (is == parser::TYPE) {
-    program->addMember("$TypeCheckerType",
-                      Stmt{curr.sourceLocation, program->bottomTypes.voidType,
+    program->addMember(Symbol{"$TypeCheckerType"},
+                      Stmt{location(), program->bottomTypes.voidType,
                            TypeDef{type()}});
-    return std::move(program);
+    return program;
     // Handle expr parser, add to program
   } else {
-    program->addMember("$TypeCheckerExpr",
-                      Stmt{curr.sourceLocation, program->bottomTypes.voidType,
+    program->addMember(Symbol{"$TypeCheckerExpr"},
+                      Stmt{location(), program->bottomTypes.voidType,
                            ExprStmt{expr()}});
-    return std::move(program);
+    return program;
   }
 }
-// Return the next global statement
-std::optional<Stmt> Parser::globals() {
+// Parallel parsing only pays off with at least this many tokens per thread
+constexpr size_t kMinParallelTokens = 64 * 1024;
+// Globals end at semicolons outside of any brackets, so they can be found
+// without parsing. A global only depends on the globals before it through the
+// names it looks up, and a let or const is never looked up for more than not
+// being a type. So types, classes, and impls are parsed here in order first,
+// and then the lets and consts are split between the workers, which look names
+// up in a table of every global by where it is first defined. Should a global
+// not end where it was expected to, everything from it on is parsed here again
+Environment* Parser::parseParallel(unsigned threads) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned>(
+      std::min<size_t>(threads, tokens->size() / kMinParallelTokens));
+  if (threads <= 1 || !program->members.empty()) return parse();
+  // Index of the semicolon ending each global
+  std::vector<size_t> ends;
+  int depth = 0;
+  for (size_t i = 0; i < tokens->size(); ++i) {
+    switch ((*tokens)[i].type) {
+      case TOKEN_TYPE::LEFT_PAREN:
+      case TOKEN_TYPE::LSQUARE:
+      case TOKEN_TYPE::LBRACKET:
+        ++depth;
+        break;
+      case TOKEN_TYPE::RIGHT_PAREN:
+      case TOKEN_TYPE::RSQUARE:
+      case TOKEN_TYPE::RBRACKET:
+        --depth;
+        break;
+      case TOKEN_TYPE::SEMI:
+        if (depth == 0) ends.push_back(i);
+        break;
+      default:
+        break;
+    }
+  }
+  auto start = [&](size_t global) {
+    return global == 0 ? 0 : ends[global - 1] + 1;
+  };
+  // A parsed global, with its diagnostics
+  struct Parsed {
+    std::optional<Stmt> stmt;
+    size_t end = 0;
+    size_t seen = 0;
+    std::string diagnostics;
+  };
+  std::vector<Parsed> parsed(ends.size());
+  program->reserve(ends.size());
+  GlobalTable table;
+  table.reserve(ends.size());
+  auto parseGlobal = [&](Parser& parser, std::ostringstream& diagnostics,
+                         size_t global) {
+    Parsed& out = parsed[global];
+    parser.globalIndex = global;
+    parser.index = start(global);
+    parser.curr = (*tokens)[parser.index];
+    parser.furthest = 0;
+    out.stmt = parser.global();
+    out.end = parser.index;
+    out.seen = parser.furthest;
+    if (diagnostics.tellp() > 0) {
+      out.diagnostics = diagnostics.str();
+      diagnostics.str("");
+    }
+  };
+  // Types, classes, and impls, in order; lets and consts only need a name
+  Stmt declared{SourceLocation{}, nullptr, DeclarationStmt{}};
+  std::vector<size_t> declarations;
+  {
+    Parser parser(*this, arena);
+    std::ostringstream diagnostics;
+    parser.errors = &diagnostics;
+    parser.globalTable = &table;
+    for (size_t global = 0; global < ends.size(); ++global) {
+      size_t first = start(global);
+      TOKEN_TYPE type = (*tokens)[first].type;
+      if (type == TOKEN_TYPE::LET || type == TOKEN_TYPE::CONST) {
+        declarations.push_back(global);
+        table.try_emplace(Symbol{source->text((*tokens)[first + 1])}, global,
+                          &declared);
+        continue;
+      }
+      parseGlobal(parser, diagnostics, global);
+      if (parsed[global].stmt) {
+        table.try_emplace(parsed[global].stmt->getName(), global,
+                          &parsed[global].stmt.value());
+      }
+    }
+  }
+  // Lets and consts, split into pieces of about the same number of tokens
+  size_t total = 0;
+  for (size_t global : declarations) total += ends[global] + 1 - start(global);
+  std::vector<size_t> cuts{0};
+  size_t counted = 0;
+  for (size_t i = 0; i < declarations.size(); ++i) {
+    counted += ends[declarations[i]] + 1 - start(declarations[i]);
+    if (counted >= total / threads * cuts.size() && cuts.size() < threads) {
+      cuts.push_back(i + 1);
+    }
+  }
+  cuts.push_back(declarations.size());
+  // This thread takes the first piece, into the program's own arena
+  std::vector<Arena*> arenas{arena};
+  for (size_t i = 2; i < cuts.size(); ++i) {
+    workerArenas.push_back(std::make_unique<Arena>());
+    arenas.push_back(workerArenas.back().get());
+  }
+  auto parsePiece = [&](size_t i) {
+    Parser parser(*this, arenas[i]);
+    std::ostringstream diagnostics;
+    parser.errors = &diagnostics;
+    parser.globalTable = &table;
+    for (size_t at = cuts[i]; at < cuts[i + 1]; ++at) {
+      parseGlobal(parser, diagnostics, declarations[at]);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i + 1 < cuts.size(); ++i) {
+    workers.emplace_back(parsePiece, i);
+  }
+  parsePiece(0);
+  for (auto& worker : workers) worker.join();
+  // Add the globals in source order
+  index = 0;
+  curr = (*tokens)[index];
+  for (size_t global = 0; global < ends.size(); ++global) {
+    if (parsed[global].end != ends[global]) {
+      index = start(global);
+      curr = (*tokens)[index];
+      break;
+    }
+    *errors << parsed[global].diagnostics;
+    index = ends[global];
+    curr = (*tokens)[index];
+    advance();
+    furthest = parsed[global].seen;
+    addGlobal(std::move(parsed[global].stmt), start(global));
+  }
+  // Anything after the last semicolon, or after the globals stopped lining up
+  while (curr.type != TOKEN_TYPE::FILE_END) {
+    size_t first = index;
+    addGlobal(globals(), first);
+  }
+  return program;
+}
+// Ensure all global statements are valid, and add them to the environment;
+// the global's tokens start at first and end before the current one
+void Parser::addGlobal(std::optional<Stmt> global, size_t first) {
+  size_t seen = std::max(furthest, index - 1);
+  if (!spans.empty()) seen = std::max(seen, spans.back().seen);
+  furthest = 0;
+  GlobalSpan span{first, index, seen, Symbol{}, false, false, 0};
+  if (global) {
+    span.name = global->getName();
+    span.declaresType = !global->isDeclarationStmt();
+    span.defines = program->addMember(span.name, std::move(global.value()));
+    if (!span.defines) *errors << "Redefinition of existing global.";
+  }
+  spans.push_back(span);
+}
+// Move every node of a kept global down by lines, after edits above it.
+// Nodes wait on explicit stacks, so a long operator chain takes no stack
+// frame per node
+static void shiftLines(Stmt& global, int lines) {
+  std::vector<Stmt*> stmts{&global};
+  std::vector<Expr*> exprs;
+  auto environment = [&](Environment* env) {
+    if (!env) return;
+    for (Stmt& member : env->members) stmts.push_back(&member);
+  };
+  while (!stmts.empty() || !exprs.empty()) {
+    if (exprs.empty()) {
+      Stmt* stmt = stmts.back();
+      stmts.pop_back();
+      stmt->location.line += lines;
+      std::visit(
+          overloaded{[&](DeclarationStmt& declaration) {
+                       exprs.push_back(declaration.val);
+                     },
+                     [&](ReturnStmt& ret) { exprs.push_back(ret.val); },
+                     [&](YieldStmt& yield) { exprs.push_back(yield.val); },
+                     [&](ExprStmt& exprStmt) { exprs.push_back(exprStmt.val); },
+                     [&](ClassStmt& classStmt) {
+                       for (Stmt& member : classStmt.parameters) {
+                         stmts.push_back(&member);
+                       }
+                     },
+                     [&](ImplStmt& impl) {
+                       for (Stmt& member : impl.parameters) {
+                         stmts.push_back(&member);
+                       }
+                     },
+                     [](auto&) {}},
+          stmt->stmt);
+      continue;
+    }
+    Expr* expr = exprs.back();
+    exprs.pop_back();
+    if (!expr) continue;
+    expr->sourceLocation.line += lines;
+    std::visit(
+        overloaded{[&](BinaryExpr& binary) {
+                     exprs.push_back(binary.left);
+                     exprs.push_back(binary.right);
+                   },
+                   [&](PrefixExpr& prefix) { exprs.push_back(prefix.expr); },
+                   [&](FunctionExpr* function) {
+                     environment(function->parameters);
+                     exprs.push_back(function->action);
+                   },
+                   [&](TypeConvExpr* conv) { exprs.push_back(conv->expr); },
+                   [&](MatchExpr* match) {
+                     exprs.push_back(match->cond);
+                     // Conditions that are types hold no positions
+                     for (CaseExpr& matchCase : match->cases) {
+                       if (matchCase.isExprCond()) {
+                         exprs.push_back(matchCase.getExpr());
+                       }
+                       exprs.push_back(matchCase.body);
+                     }
+                   },
+                   [&](IfExpr& ifExpr) {
+                     exprs.push_back(ifExpr.cond);
+                     exprs.push_back(ifExpr.thenExpr);
+                     exprs.push_back(ifExpr.elseExpr);
+                   },
+                   [&](BlockExpr* block) {
+                     for (Stmt* inner : block->stmts) stmts.push_back(inner);
+                     environment(block->env);
+                   },
+                   [&](ForExpr& forExpr) {
+                     // The loop variable, with the iterable as its value,
+                     // is only kept in the loop's environment
+                     environment(forExpr.env);
+                     exprs.push_back(forExpr.body);
+                   },
+                   [&](WhileExpr& whileExpr) {
+                     exprs.push_back(whileExpr.cond);
+                     exprs.push_back(whileExpr.body);
+                   },
+                   [&](GetExpr& get) { exprs.push_back(get.expr); },
+                   [&](CallExpr* call) {
+                     exprs.push_back(call->expr);
+                     for (Expr* param : call->params) exprs.push_back(param);
+                   },
+                   [](auto&) {}},
+        expr->innerExpr);
+  }
+}
+// Globals are parsed again from the one holding the first changed token, as
+// parse() would, until one ends where an old global starts, past the changed
+// tokens and off the last edited line. If those globals are lets and consts
+// under the same names as before, the globals after them are unchanged - they
+// only ever see such globals as not being types - and are kept, noting the
+// lines the edit added for settleLines(). Otherwise everything from the first
+// changed global on is parsed again
+Environment* Parser::reparse(size_t offset, size_t removed,
+                             std::string_view text) {
+  std::string_view before = source->source().substr(offset, removed);
+  int lines = static_cast<int>(std::count(text.begin(), text.end(), '\n') -
+                               std::count(before.begin(), before.end(), '\n'));
+  source->edit(offset, removed, text);
+  TokenEdit changed =
+      Lexer::relex(source, *tokens, offset, removed, text.size());
+  // Globals [from, to) are replaced, from the first that looked at a changed
+  // token
+  size_t from = std::partition_point(spans.begin(), spans.end(),
+                                     [&](const GlobalSpan& span) {
+                                       return span.seen < changed.first;
+                                     }) -
+                spans.begin();
+  size_t to = spans.size();
+  size_t start = from < spans.size() ? spans[from].first
+                 : spans.empty()     ? 0
+                                     : spans.back().end;
+  if (definitions.empty()) addDefinitions(0);
+  struct Reparsed {
+    std::optional<Stmt> stmt;
+    size_t first;
+    size_t end;
+    size_t seen;
+    std::string diagnostics;
+  };
+  std::vector<Reparsed> reparsed;
+  bool inStep = true;
+  int lastLine = source->locate(offset + text.size()).line;
+  std::ostream* out = errors;
+  std::ostringstream diagnostics;
+  errors = &diagnostics;
+  globalTable = &definitions;
+  index = start;
+  curr = (*tokens)[index];
+  while (curr.type != TOKEN_TYPE::FILE_END) {
+    size_t first = index;
+    globalIndex = from + reparsed.size();
+    furthest = 0;
+    std::optional<Stmt> stmt = global();
+    // Without the semicolon, parse() stops with an error
+    if (curr.type != TOKEN_TYPE::SEMI) {
+      inStep = false;
+      break;
+    }
+    size_t seen = std::max(furthest, index);
+    advance();
+    reparsed.push_back(
+        {std::move(stmt), first, index, seen, diagnostics.str()});
+    diagnostics.str("");
+    if (index < changed.newEnd ||
+        source->locate(curr.offset).line <= lastLine) {
+      continue;
+    }
+    size_t old = index - changed.newEnd + changed.oldEnd;
+    auto next = std::partition_point(
+        spans.begin() + from, spans.end(),
+        [&](const GlobalSpan& span) { return span.first < old; });
+    if (next != spans.end() && next->first == old) {
+      to = next - spans.begin();
+      break;
+    }
+  }
+  errors = out;
+  globalTable = nullptr;
+  inStep = inStep && reparsed.size() == to - from;
+  for (size_t i = 0; inStep && i < reparsed.size(); ++i) {
+    const GlobalSpan& span = spans[from + i];
+    std::optional<Stmt>& stmt = reparsed[i].stmt;
+    inStep = !span.declaresType && (stmt ? stmt->isDeclarationStmt() &&
+                                               stmt->getName() == span.name
+                                         : span.name.empty());
+  }
+  if (inStep) {
+    size_t seen = from == 0 ? 0 : spans[from - 1].seen;
+    for (size_t i = 0; i < reparsed.size(); ++i) {
+      GlobalSpan& span = spans[from + i];
+      span.first = reparsed[i].first;
+      span.end = reparsed[i].end;
+      span.seen = seen = std::max(seen, reparsed[i].seen);
+      span.lines = 0;
+      *errors << reparsed[i].diagnostics;
+      if (!reparsed[i].stmt) continue;
+      if (!span.defines) {
+        *errors << "Redefinition of existing global.";
+        continue;
+      }
+      *program->find(span.name) = std::move(reparsed[i].stmt.value());
+    }
+    for (size_t global = to; global < spans.size(); ++global) {
+      GlobalSpan& span = spans[global];
+      span.first = span.first - changed.oldEnd + changed.newEnd;
+      span.end = span.end - changed.oldEnd + changed.newEnd;
+      span.seen = seen =
+          std::max(seen, span.seen - changed.oldEnd + changed.newEnd);
+      span.lines += lines;
+    }
+    return program;
+  }
+  // Everything from the first changed global on is parsed again
+  for (size_t global = spans.size(); global-- > from;) {
+    if (spans[global].name.empty()) continue;
+    program->removeLast(spans[global].defines);
+    if (spans[global].defines) definitions.erase(spans[global].name);
+  }
+  spans.resize(from);
+  index = start;
+  curr = (*tokens)[index];
+  furthest = 0;
+  while (curr.type != TOKEN_TYPE::FILE_END) {
+    size_t first = index;
+    addGlobal(globals(), first);
+  }
+  addDefinitions(from);
+  return program;
+}
+// Kept globals that moved, and define their names, are walked once
+Environment* Parser::settleLines() {
+  for (GlobalSpan& span : spans) {
+    if (span.lines != 0 && span.defines) {
+      shiftLines(*program->find(span.name), span.lines);
+    }
+    span.lines = 0;
+  }
+  return program;
+}
+// Add the globals from one on that define their names to the table
+void Parser::addDefinitions(size_t from) {
+  // Members move when the program outgrows their array
+  if (program->members.data() != definedIn) {
+    for (auto& [name, definition] : definitions) {
+      definition.second = program->find(name);
+    }
+    definedIn = program->members.data();
+  }
+  for (size_t global = from; global < spans.size(); ++global) {
+    if (!spans[global].defines) continue;
+    definitions.try_emplace(spans[global].name, global,
+                            program->find(spans[global].name));
+  }
+}
+// Return the next global statement, up to its semicolon
+std::optional<Stmt> Parser::global() {
   std::optional<Stmt> temp;
   // Ensure global statements are valid
   if (curr.type == TOKEN_TYPE::TYPE) {
@@ -95,13 +537,18 @@ std::optional<Stmt> Parser::globals() {
   } else if (curr.type == TOKEN_TYPE::CLASS) {
     temp = classStmt();
   } else {
-    std::cerr << "Bad Global\n";
+    *errors << "Bad Global\n";
   }
+  return temp;
+}
+// Return the next global statement
+std::optional<Stmt> Parser::globals() {
+  std::optional<Stmt> temp = global();
   // Ensure statement ends in a semicolon;
   if(curr.type == TOKEN_TYPE::SEMI) {
-    curr = lexer.next();
+    advance();
   } else {
-    std::cerr << "Requires semicolon.";
+    *errors << "Requires semicolon.";
     exit(-1);
   }
   return temp;
@@ -124,50 +571,50 @@ std::optional<Stmt> Parser::stmt() {
     temp = classStmt();
   } else if (curr.type == TOKEN_TYPE::CONTINUE && inLoop) {
     requireNext(TOKEN_TYPE::CONTINUE);
-    temp = Stmt{curr.sourceLocation, nullptr, ContinueStmt{}};
-    curr = lexer.next();
+    temp = Stmt{location(), nullptr, ContinueStmt{}};
+    advance();
   } else {
     temp = exprStmt();
   }
   // Ensure statement ends in a semicolon
  if(curr.type != TOKEN_TYPE::SEMI) {
-   std::cerr << "Statements must end in a semicolon.";
+   *errors << "Statements must end in a semicolon.";
  }
- curr = lexer.next();
+ advance();
   return temp;
 }
 // Declaration statement - declare a variable
 std::optional<Stmt> Parser::declarationStmt() {
-  Stmt ans{curr.sourceLocation, nullptr, DeclarationStmt{}};
+  Stmt ans{location(), nullptr, DeclarationStmt{}};
   ans.getDeclarationStmt()->consted = curr.type == TOKEN_TYPE::CONST;
-  curr = lexer.next();
+  advance();
   // Must start with identifier
   requireNext(TOKEN_TYPE::IDEN);
-  ans.getDeclarationStmt()->name = std::string{curr.text};
-  curr = lexer.next();
+  ans.getDeclarationStmt()->name = symbol();
+  advance();
   // Declare with : or =
   if (curr.type == (TOKEN_TYPE::COLON)) {
-    curr = lexer.next();
+    advance();
     ans.type = type();
   }
   if (curr.type == TOKEN_TYPE::ASSIGN) {
-    curr = lexer.next();
+    advance();
     ans.getDeclarationStmt()->val = expr();
   }
   // Ensure const declarations include a value
   if (isImplClass != state::NORMAL && ans.getDeclarationStmt()->consted &&
       !ans.getDeclarationStmt()->val) {
-    std::cerr << "Const must have definition.";
+    *errors << "Const must have definition.";
   }
   // Ensure statement has at least a type or a value
   if (!ans.type && !ans.getDeclarationStmt()->val) {
-    std::cerr << "Either type or value must be given for inference.";
+    *errors << "Either type or value must be given for inference.";
   }
   if(ans.getDeclarationStmt()->val && !ans.type) {
     ans.type = ans.getDeclarationStmt()->val->type;
   }
   if(isImplClass != state::NORMAL && !ans.type) {
-    std::cerr << "Class definitions require types.";
+    *errors << "Class definitions require types.";
   }
   if(ans.getDeclarationStmt()->val && ans.getDeclarationStmt()->val->isFunctionExpr()) {
     ans.getDeclarationStmt()->val->getFunctionExpr()->name = ans.getName();
@@ -179,33 +626,30 @@ std::optional<Stmt> Parser::classStmt() {
   state prev = isImplClass;
   isImplClass = state::CLASS;
   Stmt ans =
-      Stmt{curr.sourceLocation, program->bottomTypes.voidType, ClassStmt{}};
-  // Begins with class
-  ans.getClassStmt()->structType =
-      std::make_shared<Type>(Type{StructType({}), {}});
-  // Class name
+      Stmt{location(), program->bottomTypes.voidType, ClassStmt{}};
+  // Begins with class, then the class name
   requireNext(TOKEN_TYPE::IDEN);
   // Disallow redeclaration
-  if (program->members.find(std::string{curr.text}) != program->members.end()) {
-    std::cerr << "Redeclaration!\n";
+  ans.getClassStmt()->name = symbol();
+  if (program->find(ans.getClassStmt()->name)) {
+    *errors << "Redeclaration!\n";
   }
-  ans.getClassStmt()->name = std::string{curr.text};
   // Define within brackets
   munch(TOKEN_TYPE::LBRACKET);
-  while (!munch(TOKEN_TYPE::RBRACKET)) {
+  std::vector<AliasType> fields;
+  while (!eatCurr(TOKEN_TYPE::RBRACKET)) {
     // Parameters are declaration values
     ans.getClassStmt()->parameters.emplace_back(declarationStmt().value());
-    if(curr.type != TOKEN_TYPE::SEMI) {std::cerr << "semicolon required after declaration.";}
-    curr = lexer.next();
-    // Store types
-    ans.getClassStmt()->structType->getStructType()->types.emplace_back(
-
-            ans.getClassStmt()->parameters.back().getDeclarationStmt()->name,
-            ans.getClassStmt()
-                ->parameters.back()
-                .getDeclarationStmt()
-                ->val->type);
+    if(curr.type != TOKEN_TYPE::SEMI) {*errors << "semicolon required after declaration.";}
+    advance();
+    // Store types, in field order - a field's index is its offset
+    fields.emplace_back(
+        ans.getClassStmt()->parameters.back().getDeclarationStmt()->name,
+        ans.getClassStmt()->parameters.back().type);
   }
+  // Types never change once made, so the struct is made whole
+  ans.getClassStmt()->structType =
+      program->types->named(StructType{std::move(fields)});
   isImplClass = prev;
   return ans;
 }
@@ -214,24 +658,29 @@ std::optional<Stmt> Parser::implStmt() {
   state prev = isImplClass;
   isImplClass = state::IMPL;
   Stmt ans =
-      Stmt{curr.sourceLocation, program->bottomTypes.voidType, ImplStmt{}};
+      Stmt{location(), program->bottomTypes.voidType, ImplStmt{}};
   // Begins with impl then an identifier
   munch(TOKEN_TYPE::IMPL);
   requireNext(TOKEN_TYPE::IDEN);
-  ans.getImplStmt()->name = std::string{curr.text};
+  ans.getImplStmt()->name = symbol();
   // For, ensure impl is declared before implementation and only classes are
   // decorated
   if (munch(TOKEN_TYPE::FOR)) {
     requireNext(TOKEN_TYPE::IDEN);
-    ans.getImplStmt()->decorating = std::string{curr.text};
-    if (!program->getMember(ans.getImplStmt()->name) ||
-        !program->getMember(ans.getImplStmt()->name)->isImplStmt()) {
-      std::cerr << "Cannot have implementation before declaration of Impl\n";
+    ans.getImplStmt()->decorating = symbol();
+    std::string decorated = "$";
+    decorated.append(ans.getImplStmt()->name.str())
+        .append("$")
+        .append(ans.getImplStmt()->decorating.str());
+    ans.getImplStmt()->decorated = Symbol{decorated};
+    if (!lookup(ans.getImplStmt()->name) ||
+        !lookup(ans.getImplStmt()->name)->isImplStmt()) {
+      *errors << "Cannot have implementation before declaration of Impl\n";
     }
-    if (!program->getMember(ans.getImplStmt()->decorating)->isClassStmt()) {
-      std::cerr << "Can only decorate classes.";
+    if (!lookup(ans.getImplStmt()->decorating)->isClassStmt()) {
+      *errors << "Can only decorate classes.";
     }
-    Stmt* impl = program->getMember(ans.getImplStmt()->name);
+    Stmt* impl = lookup(ans.getImplStmt()->name);
     int memberCount = 0;
     // Statements within brackets
     munch(TOKEN_TYPE::LBRACKET);
@@ -244,7 +693,7 @@ std::optional<Stmt> Parser::implStmt() {
               ->parameters[memberCount]
               .getDeclarationStmt()
               ->name) {
-        std::cerr << "Invalid impl name.";
+        *errors << "Invalid impl name.";
         return std::nullopt;
       }
 
@@ -252,7 +701,7 @@ std::optional<Stmt> Parser::implStmt() {
     }
     // Ensure full implementation
     if (memberCount != impl->getImplStmt()->parameters.size()) {
-      std::cerr << "Impl not fully implemented.\n";
+      *errors << "Impl not fully implemented.\n";
       return std::nullopt;
     }
     // Insert parameters
@@ -262,55 +711,57 @@ std::optional<Stmt> Parser::implStmt() {
     isImplClass = prev;
     return ans;
   } else {
-    ans.getImplStmt()->implType = std::make_shared<Type>(Type{Impl{{}}, {}});
     // Within brackets
     munch(TOKEN_TYPE::LBRACKET);
+    std::vector<AliasType> includes;
     while (!munch(TOKEN_TYPE::RBRACKET)) {
       // Store necessary data
       ans.getImplStmt()->parameters.emplace_back(declarationStmt().value());
-      ans.getImplStmt()->implType->getImpl()->includes.emplace_back(
+      includes.emplace_back(
           ans.getImplStmt()->parameters.back().getDeclarationStmt()->name,
           ans.getImplStmt()
               ->parameters.back()
               .getDeclarationStmt()
               ->val->type);
     }
+    ans.getImplStmt()->implType =
+        program->types->named(Impl{std::move(includes)});
   }
   isImplClass = prev;
   return ans;
 }
 // Yield statement
 std::optional<Stmt> Parser::yieldStmt() {
-  auto location = curr.sourceLocation;
-  curr = lexer.next();
+  auto start = location();
+  advance();
   if (!inBlock) return std::nullopt;
-  std::unique_ptr<Expr> exp(expr());
-  return Stmt{location, exp->type, YieldStmt{std::move(exp)}};
+  Expr* exp(expr());
+  return Stmt{start, exp->type, YieldStmt{exp}};
 }
 // Return statement
 std::optional<Stmt> Parser::returnStmt() {
-  auto location = curr.sourceLocation;
-  curr = lexer.next();
-  std::unique_ptr<Expr> exp(expr());
-  return Stmt{location, exp->type, ReturnStmt{std::move(exp)}};
+  auto start = location();
+  advance();
+  Expr* exp(expr());
+  return Stmt{start, exp->type, ReturnStmt{exp}};
 }
 // Expression statement
 std::optional<Stmt> Parser::exprStmt() {
-  auto location = curr.sourceLocation;
-  return Stmt{location, program->bottomTypes.voidType, ExprStmt{expr()}};
+  auto start = location();
+  return Stmt{start, program->bottomTypes.voidType, ExprStmt{expr()}};
 }
 
 // Type definition
 std::optional<Stmt> Parser::typeDef() {
-  auto location = curr.sourceLocation;
-  curr = lexer.next();
+  auto start = location();
+  advance();
   // Identifier = ...
   requireNext(TOKEN_TYPE::IDEN);
-  std::string name{curr.text};
+  Symbol name = symbol();
   munch(TOKEN_TYPE::ASSIGN);
   return Stmt{
-      location, program->bottomTypes.voidType,
-      TypeDef{std::make_shared<Type>(Type{AliasType{name, type()}, {}})}};
+      start, program->bottomTypes.voidType,
+      TypeDef{program->types->named(AliasType{name, type()})}};
 }
 // Product types
 std::shared_ptr<Type> Parser::productType() {
@@ -327,14 +778,14 @@ std::shared_ptr<Type> Parser::productType() {
     case TOKEN_TYPE::SELF:
       // Ensure self is only referenced in the proper places
       if (isImplClass == state::NORMAL) {
-        std::cerr << "Cannot reference self outside of IMPL or Class.\n";
+        *errors << "Cannot reference self outside of IMPL or Class.\n";
         break;
       }
       return program->bottomTypes.selfType;
     case TOKEN_TYPE::IDEN:
       return bottomType();
     default:
-      std::cerr << "This is not a type";
+      *errors << "This is not a type";
   }
 }
 // Function type
@@ -342,32 +793,31 @@ std::shared_ptr<Type> Parser::functionType() {
   // fn (...
   munch(TOKEN_TYPE::FN);
   munch(TOKEN_TYPE::LEFT_PAREN);
-  std::shared_ptr<Type> ans = std::make_shared<Type>(Type{FunctionType{}, {}});
+  std::vector<std::shared_ptr<Type>> parameters;
   // Between parentheses, add parameters separated by commas
   while (curr.type != TOKEN_TYPE::RIGHT_PAREN) {
-    ans->getFunctionType()->parameters.emplace_back(type());
+    parameters.emplace_back(type());
     if (curr.type != TOKEN_TYPE::RIGHT_PAREN) munch(TOKEN_TYPE::COMMA);
   }
   // ...)->
   munch(TOKEN_TYPE::RIGHT_PAREN);
   munch(TOKEN_TYPE::ARROW);
-  ans->getFunctionType()->returner = type();
-  return ans;
+  std::shared_ptr<Type> returner = type();
+  return program->types->function(std::move(returner), std::move(parameters));
 }
 // Optional type
 std::shared_ptr<Type> Parser::optionalType() {
   // optional [...]
   munch(TOKEN_TYPE::OPTIONAL);
   munch(TOKEN_TYPE::LSQUARE);
-  std::shared_ptr<Type> ans =
-      std::make_shared<Type>(Type{OptionalType{type()}, {}});
+  std::shared_ptr<Type> optional = type();
   eatCurr(TOKEN_TYPE::RSQUARE);
   // Return void type if necessary
-  if (ans->getOptionalType()->optional->isBottomType() &&
-      ans->getOptionalType()->optional->getBottomType() == BottomType::VOID) {
+  if (optional->isBottomType() &&
+      optional->getBottomType() == BottomType::VOID) {
     return program->bottomTypes.voidType;
   }
-  return ans;
+  return program->types->optional(std::move(optional));
 }
 // List type
 std::shared_ptr<Type> Parser::listType() {
@@ -377,84 +827,70 @@ std::shared_ptr<Type> Parser::listType() {
   int listSize = -2;
   // Integer (or *),...
   if (curr.type == TOKEN_TYPE::INT) {
-    std::from_chars(curr.text.data(), curr.text.data() + curr.text.size(),
+    std::from_chars(text().data(), text().data() + text().size(),
                     listSize);
   } else if (curr.type == TOKEN_TYPE::STAR) {
     listSize = -1;
   } else {
-    std::cerr << "Bad INT\n";
+    *errors << "Bad INT\n";
   }
   munch(TOKEN_TYPE::COMMA);
-  std::shared_ptr<Type> ans =
-      std::make_shared<Type>(Type{ListType{listSize, std::move(type())}, {}});
+  std::shared_ptr<Type> ans = program->types->list(listSize, type());
   eatCurr(TOKEN_TYPE::RSQUARE);
   return ans;
 }
 // Tuple type
 std::shared_ptr<Type> Parser::tupleType() {
-  curr = lexer.next();
-  std::shared_ptr<Type> ans = std::make_shared<Type>(Type{TupleType{}, {}});
+  advance();
+  std::vector<std::shared_ptr<Type>> types;
   // Between parens, add types separated by commas
   while (curr.type != TOKEN_TYPE::RIGHT_PAREN) {
-    ans->getTupleType()->types.emplace_back(type());
+    types.emplace_back(type());
     if (curr.type != TOKEN_TYPE::RIGHT_PAREN) {
       eatCurr(TOKEN_TYPE::COMMA);
     }
   }
   eatCurr(TOKEN_TYPE::RIGHT_PAREN);
-  return ans;
+  return program->types->tuple(std::move(types));
 }
 // Type type
 std::shared_ptr<Type> Parser::type() {
   // Sum and product types
   std::shared_ptr<Type> prev = productType();
   if (curr.type != TOKEN_TYPE::BITOR) return prev;
-  std::shared_ptr<Type> ans = std::make_shared<Type>(Type{SumType{{prev}}, {}});
+  std::vector<std::shared_ptr<Type>> types{prev};
   while (curr.type == TOKEN_TYPE::BITOR) {
-    curr = lexer.next();
-    ans->getSumType()->types.emplace_back(productType());
+    advance();
+    types.emplace_back(productType());
   }
-  return ans;
+  return program->types->sum(std::move(types));
 }
 // Primary (bottom) types
 std::shared_ptr<Type> Parser::bottomType() {
-  if (curr.text == "int") {
-    curr = lexer.next();
+  if (text() == "int") {
+    advance();
     return program->bottomTypes.intType;
-  } else if (curr.text == "float") {
-    curr = lexer.next();
+  } else if (text() == "float") {
+    advance();
     return program->bottomTypes.floatType;
-  } else if (curr.text == "void") {
-    curr = lexer.next();
+  } else if (text() == "void") {
+    advance();
     return program->bottomTypes.voidType;
-  } else if (curr.text == "char") {
-    curr = lexer.next();
+  } else if (text() == "char") {
+    advance();
     return program->bottomTypes.charType;
-  } else if (curr.text == "bool") {
-    curr = lexer.next();
+  } else if (text() == "bool") {
+    advance();
     return program->bottomTypes.boolType;
   } else {
     // Identifier, ensure proper type
-    std::string typeText{curr.text};
-    curr = lexer.next();
-    if (program->getMember(typeText)) {
-      Stmt* s = program->getMember(typeText);
-      if (s->isTypeDef()) {
-        return s->getTypeDef()->type;
-      } else if (s->isClassStmt()) {
-        return s->getClassStmt()->structType;
-      } else if (s->isImplStmt()) {
-        return s->getImplStmt()->implType;
-      } else {
-        std::cerr << "Identifier is not of a valid type.\n";
-      }
-    } else {
-      return std::make_shared<Type>(Type{AliasType(typeText, nullptr), {}});
-    }
+    Symbol typeText = symbol();
+    advance();
+    return program->getType(typeText, lookup(typeText), *errors);
   }
 }
 // Expressions
-std::unique_ptr<Expr> Parser::expr() {
+Expr* Parser::expr() {
   // Assignment by default
   switch (curr.type) {
     case TOKEN_TYPE::IF:
@@ -474,22 +910,24 @@ std::unique_ptr<Expr> Parser::expr() {
   }
 }
 // For expression
-std::unique_ptr<Expr> Parser::forExpr() {
+Expr* Parser::forExpr() {
   // for keyword, inner environment, condition, statements...
   requireNext(TOKEN_TYPE::FOR);
-  std::unique_ptr<Expr> ans =
-      std::make_unique<Expr>(curr.sourceLocation, nullptr, ForExpr{});
+  Expr* ans = arena->make<Expr>(location(), nullptr, ForExpr{});
   bool storage = inLoop;
   inLoop = true;
-  curr = lexer.next();
-  auto prev = std::move(program);
-  program = prev->generateInnerEnvironment();
+  advance();
+  auto prev = program;
+  program = innerEnvironment();
   auto iter = forConditionExpr();
-  if (!iter) return nullptr;
-  program->addMember(iter->getDeclarationStmt()->name, std::move(iter.value()));
+  if (!iter) {
+    outerEnvironment(prev);
+    return nullptr;
+  }
+  declare(iter->getDeclarationStmt()->name, std::move(iter.value()));
   ans->getForExpr()->body = expr();
-  ans->getForExpr()->env = std::move(program);
-  program = std::move(prev);
+  ans->getForExpr()->env = program;
+  outerEnvironment(prev);
   inLoop = storage;
   return ans;
 }
@@ -497,34 +935,32 @@ std::unique_ptr<Expr> Parser::forExpr() {
 std::optional<Stmt> Parser::forConditionExpr() {
   // Identifier in...
   requireNext(TOKEN_TYPE::IDEN);
-  std::string name{curr.text};
-  Stmt declaration{curr.sourceLocation, nullptr,
+  Symbol name = symbol();
+  Stmt declaration{location(), nullptr,
                    DeclarationStmt{false, name, nullptr}};
   munch(TOKEN_TYPE::IN);
   declaration.getDeclarationStmt()->val = expr();
   return declaration;
 }
 // If expression
-std::unique_ptr<Expr> Parser::ifExpr() {
-  curr = lexer.next();
-  std::unique_ptr<Expr> exp =
-      std::make_unique<Expr>(curr.sourceLocation, nullptr, IfExpr{});
+Expr* Parser::ifExpr() {
+  advance();
+  Expr* exp = arena->make<Expr>(location(), nullptr, IfExpr{});
   // If, condition, then, else
   exp->getIfExpr()->cond = expr();
   exp->getIfExpr()->thenExpr = expr();
   if (curr.type == TOKEN_TYPE::ELSE) {
-    curr = lexer.next();
+    advance();
     exp->getIfExpr()->elseExpr = expr();
   }
   return exp;
 }
 // While expression
-std::unique_ptr<Expr> Parser::whileExpr() {
-  curr = lexer.next();
+Expr* Parser::whileExpr() {
+  advance();
   bool storage = inLoop;
   inLoop = true;
-  std::unique_ptr<Expr> exp =
-      std::make_unique<Expr>(curr.sourceLocation, nullptr, WhileExpr{});
+  Expr* exp = arena->make<Expr>(location(), nullptr, WhileExpr{});
   // Condition and body
   exp->getWhileExpr()->cond = expr();
   exp->getWhileExpr()->body = expr();
@@ -532,18 +968,16 @@ std::unique_ptr<Expr> Parser::whileExpr() {
   return exp;
 }
 // Block of code, with environment, between brackets
-std::unique_ptr<Expr> Parser::block() {
-  curr = lexer.next();
-  std::unique_ptr<Environment> prev = std::move(program);
-  program = prev->generateInnerEnvironment();
+Expr* Parser::block() {
+  advance();
+  Environment* prev = program;
+  program = innerEnvironment();
   bool storage = inBlock;
   inBlock = true;
-  std::unique_ptr<Expr> exp =
-      std::make_unique<Expr>(curr.sourceLocation, nullptr, BlockExpr{});
+  Expr* exp = arena->make<Expr>(location(), nullptr, arena->make<BlockExpr>());
   while (curr.type != TOKEN_TYPE::RBRACKET) {
     // Add statements, report if returns or yields
-    exp->getBlockExpr()->stmts.emplace_back(
-        std::make_unique<Stmt>(stmt().value()));
+    exp->getBlockExpr()->stmts.emplace_back(arena->make<Stmt>(stmt().value()));
     if (exp->getBlockExpr()->stmts.back()->isReturnStmt()) {
       exp->getBlockExpr()->returns = true;
     } else if (exp->getBlockExpr()->stmts.back()->isYieldStmt()) {
@@ -551,58 +985,100 @@ std::unique_ptr<Expr> Parser::block() {
     }
   }
   if(curr.type != TOKEN_TYPE::RBRACKET) {
-    std::cerr << "Blocks need to be close\n";
+    *errors << "Blocks need to be close\n";
   }
-  curr = lexer.next();
-  exp->getBlockExpr()->env = std::move(program);
+  advance();
+  exp->getBlockExpr()->env = program;
   inBlock = storage;
-  program = std::move(prev);
+  outerEnvironment(prev);
   return exp;
 }
 // Match expression
-std::unique_ptr<Expr> Parser::matchExpr() {
-  std::unique_ptr<Expr> ans =
-      std::make_unique<Expr>(curr.sourceLocation, nullptr, MatchExpr{});
+Expr* Parser::matchExpr() {
+  Expr* ans = arena->make<Expr>(location(), nullptr, arena->make<MatchExpr>());
   // match, condition, cases between brackets
-  curr = lexer.next();
+  advance();
   ans->getMatchExpr()->cond = expr();
   if (curr.type != TOKEN_TYPE::LBRACKET) {
-    std::cerr << "Match Expression needs Cases.";
+    *errors << "Match Expression needs Cases.";
   }
-  curr = lexer.next();
+  advance();
   while (curr.type != (TOKEN_TYPE::RBRACKET)) {
     ans->getMatchExpr()->cases.emplace_back(caseExpr());
   }
-  curr = lexer.next();
+  advance();
   return ans;
 }
 // Case expression
 CaseExpr Parser::caseExpr() {
   // case condition -> body
   if(curr.type != TOKEN_TYPE::CASE) {
-    std::cerr << "Match expressions can only contain cases.\n";
+    *errors << "Match expressions can only contain cases.\n";
   }
-  curr = lexer.next();
+  advance();
   CaseExpr ans{};
-  ans.cond = "";
-  while (!eatCurr(TOKEN_TYPE::ARROW)) {
-    std::get<std::string>(ans.cond).append(curr.text);
-    curr = lexer.next();
+  // Type syntax is kept as a type, anything else as an expression; the type
+  // checker makes names into types when matching on a sum type
+  if (typeCase()) {
+    ans.cond = type();
+  } else {
+    ans.cond = expr();
+  }
+  if (!eatCurr(TOKEN_TYPE::ARROW)) {
+    *errors << "Cases need an arrow at: " << location().line << ":"
+              << location().character << ".\n";
   }
   ans.body = expr();
   ans.type = ans.body->type;
   return ans;
 }
+// Returns true if a case starts with syntax only a type has (list, optional,
+// or function types, and tuples)
+bool Parser::typeCase() const {
+  switch (curr.type) {
+    case TOKEN_TYPE::LIST:
+    case TOKEN_TYPE::OPTIONAL:
+    case TOKEN_TYPE::FN:
+      return true;
+    case TOKEN_TYPE::LEFT_PAREN: {
+      // Parenthesized expressions have no commas at the top level
+      int depth = 0;
+      for (size_t k = 0;; ++k) {
+        switch (peek(k).type) {
+          case TOKEN_TYPE::LEFT_PAREN:
+          case TOKEN_TYPE::LSQUARE:
+            ++depth;
+            break;
+          case TOKEN_TYPE::RIGHT_PAREN:
+          case TOKEN_TYPE::RSQUARE:
+            if (--depth == 0) return k == 1;
+            break;
+          case TOKEN_TYPE::COMMA:
+            if (depth == 1) return true;
+            break;
+          case TOKEN_TYPE::ARROW:
+          case TOKEN_TYPE::FILE_END:
+          case TOKEN_TYPE::ERROR:
+            return false;
+          default:
+            break;
+        }
+      }
+    }
+    default:
+      return false;
+  }
+}
 // Function expression
-std::unique_ptr<Expr> Parser::functionExpr() {
-  curr = lexer.next();
+Expr* Parser::functionExpr() {
+  advance();
   // Has own environment
-  std::unique_ptr<Environment> prev = std::move(program);
-  program = prev->generateInnerEnvironment();
-  std::unique_ptr<Expr> exp =
-      std::make_unique<Expr>(curr.sourceLocation, nullptr, FunctionExpr{});
+  Environment* prev = program;
+  program = innerEnvironment();
+  Expr* exp =
+      arena->make<Expr>(location(), nullptr, arena->make<FunctionExpr>());
   munch(TOKEN_TYPE::LEFT_PAREN);
-  curr = lexer.next();
+  advance();
   std::vector<std::shared_ptr<Type>> types;
   bool inClass = isImplClass == state::CLASS;
   int arity = 0;
@@ -614,20 +1090,19 @@ std::unique_ptr<Expr> Parser::functionExpr() {
         inClass = false;
         if (curr.type == TOKEN_TYPE::SELF) {
           types.emplace_back(program->bottomTypes.selfType);
-          program->addMember(
-              "self", Stmt{curr.sourceLocation, program->bottomTypes.selfType,
-                           DeclarationStmt{false, "self", nullptr}});
+          Symbol self{"self"};
+          declare(self, Stmt{location(), program->bottomTypes.selfType,
+                             DeclarationStmt{false, self, nullptr}});
           ++arity;
         }
       } else {
         inClass = false;
-        std::string paramName{curr.text};
+        Symbol paramName = symbol();
         munch(TOKEN_TYPE::COLON);
         std::shared_ptr<Type> paramType = type();
         types.emplace_back(paramType);
-        program->addMember(paramName,
-                          Stmt{curr.sourceLocation, paramType,
-                               DeclarationStmt{false, paramName, nullptr}});
+        declare(paramName, Stmt{location(), paramType,
+                                DeclarationStmt{false, paramName, nullptr}});
         ++arity;
       }
     } while (eatCurr(TOKEN_TYPE::COMMA));
@@ -637,245 +1112,161 @@ std::unique_ptr<Expr> Parser::functionExpr() {
   // Function has parameters, return type, and action
   exp->getFunctionExpr()->returnType = type();
   exp->getFunctionExpr()->action = expr();
-  exp->getFunctionExpr()->parameters = std::move(program);
-  program = std::move(prev);
-  exp->type = std::make_shared<Type>(
-      Type{FunctionType{exp->getFunctionExpr()->returnType, types},
-           std::vector<std::shared_ptr<Impl>>{}});
+  exp->getFunctionExpr()->parameters = program;
+  outerEnvironment(prev);
+  exp->type = program->types->function(exp->getFunctionExpr()->returnType,
+                                       std::move(types));
   return exp;
 }
-// Assignment (operation priority included, in the subsequent operations)
-std::unique_ptr<Expr> Parser::assign() {
-  std::unique_ptr<Expr> ans = rangeExpr();
-  // Create binary expression if next token is ASSIGN
-  if (curr.type == (TOKEN_TYPE::ASSIGN)) {
-    std::unique_ptr<Expr> assignExpr =
-        std::make_unique<Expr>(Expr::makeBinary(curr, ans->type));
-    assignExpr->getBinaryExpr()->left = std::move(ans);
-    curr = lexer.next();
-    assignExpr->getBinaryExpr()->right = expr();
-    ans = std::move(assignExpr);
-  }
-  return ans;
-}
-// Range expression
-std::unique_ptr<Expr> Parser::rangeExpr() {
-  std::unique_ptr<Expr> exp = orExpr();
-  if (curr.type == TOKEN_TYPE::RANGE || curr.type == TOKEN_TYPE::INCRANGE) {
-    std::unique_ptr<Expr> range =
-        std::make_unique<Expr>(Expr::makeBinary(curr, exp->type));
-    curr = lexer.next();
-    range->getBinaryExpr()->left = std::move(exp);
-    range->getBinaryExpr()->right = orExpr();
-    exp = std::move(range);
-  }
-  return exp;
-}
-// Or expression
-std::unique_ptr<Expr> Parser::orExpr() {
-  std::unique_ptr<Expr> expr = andExpr();
-  // Boolean types
-  while (curr.type == TOKEN_TYPE::OR) {
-    std::unique_ptr<Expr> binary = std::make_unique<Expr>(
-        Expr::makeBinary(curr, program->bottomTypes.boolType));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->getBinaryExpr()->right = andExpr();
-    expr = std::move(binary);
-  }
-  return expr;
-}
-// And expression
-std::unique_ptr<Expr> Parser::andExpr() {
-  std::unique_ptr<Expr> expr = bitOrExpr();
-  while (curr.type == TOKEN_TYPE::AND) {
-    std::unique_ptr<Expr> binary = std::make_unique<Expr>(
-        Expr::makeBinary(curr, program->bottomTypes.intType));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->getBinaryExpr()->right = bitOrExpr();
-    expr = std::move(binary);
-  }
-  return expr;
-}
-// Bit or expression
-std::unique_ptr<Expr> Parser::bitOrExpr() {
-  std::unique_ptr<Expr> expr = xorExpr();
-  while (curr.type == TOKEN_TYPE::BITOR) {
-    std::unique_ptr<Expr> binary = std::make_unique<Expr>(
-        Expr::makeBinary(curr, program->bottomTypes.intType));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->getBinaryExpr()->right = xorExpr();
-    expr = std::move(binary);
-  }
-  return expr;
-}
-// Exclusive or expression
-std::unique_ptr<Expr> Parser::xorExpr() {
-  std::unique_ptr<Expr> expr = bitAndExpr();
-  while (curr.type == TOKEN_TYPE::XOR) {
-    std::unique_ptr<Expr> binary = std::make_unique<Expr>(
-        Expr::makeBinary(curr, program->bottomTypes.intType));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->getBinaryExpr()->right = bitAndExpr();
-    expr = std::move(binary);
-  }
-  return expr;
-}
-// Bit and expression
-std::unique_ptr<Expr> Parser::bitAndExpr() {
-  std::unique_ptr<Expr> expr = equateExpr();
-  while (curr.type == TOKEN_TYPE::BITAND) {
-    std::unique_ptr<Expr> binary = std::make_unique<Expr>(
-        Expr::makeBinary(curr, program->bottomTypes.intType));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->getBinaryExpr()->right = equateExpr();
-    expr = std::move(binary);
+// Binding power of an infix operator
+Parser::Power Parser::infixPower(TOKEN_TYPE type) {
+  switch (type) {
+    case TOKEN_TYPE::ASSIGN:
+      return kAssign;
+    case TOKEN_TYPE::RANGE:
+    case TOKEN_TYPE::INCRANGE:
+      return kRange;
+    case TOKEN_TYPE::OR:
+      return kOr;
+    case TOKEN_TYPE::AND:
+      return kAnd;
+    case TOKEN_TYPE::BITOR:
+      return kBitOr;
+    case TOKEN_TYPE::XOR:
+      return kXor;
+    case TOKEN_TYPE::BITAND:
+      return kBitAnd;
+    case TOKEN_TYPE::EQUALS:
+    case TOKEN_TYPE::NEQUALS:
+      return kEquate;
+    case TOKEN_TYPE::LANGLE:
+    case TOKEN_TYPE::LEQ:
+    case TOKEN_TYPE::RANGLE:
+    case TOKEN_TYPE::GEQ:
+      return kRelation;
+    case TOKEN_TYPE::LSHIFT:
+    case TOKEN_TYPE::RSHIFT:
+      return kShift;
+    case TOKEN_TYPE::PLUS:
+    case TOKEN_TYPE::MINUS:
+      return kAdd;
+    case TOKEN_TYPE::STAR:
+    case TOKEN_TYPE::SLASH:
+      return kMult;
+    default:
+      return kNone;
   }
-  return expr;
 }
-// Equate expression (==, !=)
-std::unique_ptr<Expr> Parser::equateExpr() {
-  std::unique_ptr<Expr> expr = notExpr();
-  while (curr.type == TOKEN_TYPE::EQUALS || curr.type == TOKEN_TYPE::NEQUALS) {
-    std::unique_ptr<Expr> binary = std::make_unique<Expr>(
-        Expr::makeBinary(curr, program->bottomTypes.intType));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->getBinaryExpr()->right = notExpr();
-    expr = std::move(binary);
-  }
-  return expr;
+// Assignment and binary operators (operation priority included), by
+// precedence climbing
+Expr* Parser::assign() {
+  Power reach;
+  return binary(kNone, reach);
 }
-// Not expression (!)
-std::unique_ptr<Expr> Parser::notExpr() {
-  if (curr.type == TOKEN_TYPE::NOT) {
-    std::unique_ptr<Expr> expr = std::make_unique<Expr>(
-        Expr{curr.sourceLocation, nullptr, PrefixExpr{curr}});
-    curr = lexer.next();
-    expr->getPrefixExpr()->expr = access();
-    expr->type = expr->getPrefixExpr()->expr->type;
-    return expr;
+// Binary expression of operators binding at least as tight as minPower.
+// reach is set to the tightest operator that may still take the result as
+// its left side: ranges only take an assignment after them, and a not
+// expression only looser operators than a relation
+Expr* Parser::binary(Power minPower, Power& reach) {
+  Expr* exp;
+  reach = kStrongest;
+  if (curr.type == TOKEN_TYPE::NOT && minPower <= kRelation) {
+    exp = prefix();
+    reach = kEquate;
+  } else if (curr.type == TOKEN_TYPE::MINUS) {
+    exp = prefix();
   } else {
-    return relation();
-  }
-}
-std::unique_ptr<Expr> Parser::relation() {
-  std::unique_ptr<Expr> expr = shift();
-  while (curr.type == TOKEN_TYPE::LANGLE || curr.type == TOKEN_TYPE::LEQ || curr.type == TOKEN_TYPE::RANGLE || curr.type == TOKEN_TYPE::GEQ) {
-    std::unique_ptr<Expr> binary =
-        std::make_unique<Expr>(Expr::makeBinary(curr, nullptr));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->type = binary->getBinaryExpr()->left->type;
-    binary->getBinaryExpr()->right = shift();
-    expr = std::move(binary);
+    exp = access();
   }
-  return expr;
-}
-std::unique_ptr<Expr> Parser::shift() {
-  std::unique_ptr<Expr> expr = add();
-  while (curr.type == TOKEN_TYPE::LSHIFT || curr.type == TOKEN_TYPE::RSHIFT) {
-    std::unique_ptr<Expr> binary =
-        std::make_unique<Expr>(Expr::makeBinary(curr, nullptr));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->type = binary->getBinaryExpr()->left->type;
-    binary->getBinaryExpr()->right = add();
-    expr = std::move(binary);
-  }
-  return expr;
-}
-// Add (+ and -)
-std::unique_ptr<Expr> Parser::add() {
-  std::unique_ptr<Expr> expr = mult();
-  while (curr.type == TOKEN_TYPE::PLUS || curr.type == TOKEN_TYPE::MINUS) {
-    std::unique_ptr<Expr> binary =
-        std::make_unique<Expr>(Expr::makeBinary(curr, nullptr));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->type = binary->getBinaryExpr()->left->type;
-    binary->getBinaryExpr()->right = mult();
-    expr = std::move(binary);
+  for (;;) {
+    Power power = infixPower(curr.type);
+    if (power == kNone || power < minPower || power > reach) break;
+    // Logical or gives a bool, the bitwise operators and equality an int, and
+    // everything else the type of its left side
+    std::shared_ptr<Type> type;
+    if (power == kOr) {
+      type = program->bottomTypes.boolType;
+    } else if (power >= kAnd && power <= kEquate) {
+      type = program->bottomTypes.intType;
+    } else {
+      type = exp->type;
+    }
+    Expr* node =
+        arena->make<Expr>(Expr::makeBinary(curr, location(), std::move(type)));
+    advance();
+    node->getBinaryExpr()->left = exp;
+    exp = node;
+    if (power == kAssign) {
+      // Right associative, and may be any expression
+      node->getBinaryExpr()->right = expr();
+      reach = kNone;
+      break;
+    }
+    node->getBinaryExpr()->right =
+        binary(static_cast<Power>(power + 1), reach);
+    if (power == kRange) reach = kAssign;
   }
-  return expr;
+  return exp;
 }
-// Multiply (* and /)
-std::unique_ptr<Expr> Parser::mult() {
-  std::unique_ptr<Expr> expr = negate();
-  while (curr.type == TOKEN_TYPE::STAR || curr.type == TOKEN_TYPE::SLASH) {
-    std::unique_ptr<Expr> binary =
-        std::make_unique<Expr>(Expr::makeBinary(curr, nullptr));
-    curr = lexer.next();
-    binary->getBinaryExpr()->left = std::move(expr);
-    binary->type = binary->getBinaryExpr()->left->type;
-    binary->getBinaryExpr()->right = negate();
-    expr = std::move(binary);
-  }
+// Prefix expression (! and -), applied to an access
+Expr* Parser::prefix() {
+  Expr* expr = arena->make<Expr>(Expr{location(), nullptr, PrefixExpr{curr}});
+  advance();
+  expr->getPrefixExpr()->expr = access();
+  expr->type = expr->getPrefixExpr()->expr->type;
   return expr;
 }
-// Negate (-)
-std::unique_ptr<Expr> Parser::negate() {
-  if (curr.type == TOKEN_TYPE::MINUS) {
-    std::unique_ptr<Expr> expr = std::make_unique<Expr>(
-        Expr{curr.sourceLocation, nullptr, PrefixExpr{curr}});
-    curr = lexer.next();
-    expr->getPrefixExpr()->expr = access();
-    expr->type = expr->getPrefixExpr()->expr->type;
-    return expr;
-  } else {
-    return access();
-  }
-}
 // Access
-std::unique_ptr<Expr> Parser::access() {
-  std::unique_ptr<Expr> exp = primary();
+Expr* Parser::access() {
+  Expr* exp = primary();
   // Deal with convert (within parentheses, separated by comma)
-  if (exp->isLiteralExpr() && exp->getLiteralExpr()->name == "convert") {
-    auto typeHolder = std::make_unique<Expr>(
-        Expr{curr.sourceLocation, nullptr, LiteralExpr{curr.text}});
-    curr = lexer.next();
-    while (!munch(TOKEN_TYPE::COMMA)) {
-      if (curr.type == TOKEN_TYPE::FILE_END) return nullptr;
-      typeHolder->getLiteralExpr()->name.append(curr.text);
-      curr = lexer.next();
+  if (exp->isLiteralExpr() && exp->getLiteralExpr()->name.str() == "convert") {
+    // The target type is kept as the type of a holder expression
+    auto typeHolder =
+        arena->make<Expr>(Expr{location(), nullptr, LiteralExpr{}});
+    if (!eatCurr(TOKEN_TYPE::LEFT_PAREN)) {
+      *errors << "Convert needs a type and a value at: " << location().line
+                << ":" << location().character << ".\n";
+      return nullptr;
+    }
+    typeHolder->type = type();
+    if (!eatCurr(TOKEN_TYPE::COMMA)) {
+      *errors << "Convert needs a type and a value at: " << location().line
+                << ":" << location().character << ".\n";
+      return nullptr;
     }
-    auto converter =
-        std::make_unique<Expr>(Expr{exp->sourceLocation, nullptr, CallExpr{}});
-    converter->getCallExpr()->expr = std::move(exp);
-    converter->getCallExpr()->params.emplace_back(std::move(typeHolder));
-    converter->getCallExpr()->params.emplace_back(std::move(expr()));
+    auto converter = arena->make<Expr>(exp->sourceLocation, nullptr,
+                                       arena->make<CallExpr>());
+    converter->getCallExpr()->expr = exp;
+    converter->getCallExpr()->params.emplace_back(typeHolder);
+    converter->getCallExpr()->params.emplace_back(expr());
     eatCurr(TOKEN_TYPE::RIGHT_PAREN);
     return converter;
   }
   for (;;) {
     // Between parens
     if (curr.type == TOKEN_TYPE::LEFT_PAREN) {
-      std::unique_ptr<Expr> func =
-          std::make_unique<Expr>(curr.sourceLocation, nullptr, CallExpr{});
-      func->getCallExpr()->expr = std::move(exp);
-      curr = lexer.next();
+      Expr* func =
+          arena->make<Expr>(location(), nullptr, arena->make<CallExpr>());
+      func->getCallExpr()->expr = exp;
+      advance();
       if (curr.type != TOKEN_TYPE::RIGHT_PAREN) {
         do {
           // Add parameters, separated by commas
           func->getCallExpr()->params.emplace_back(expr());
         } while (eatCurr(TOKEN_TYPE::COMMA));
       }
-      exp = std::move(func);
-      curr = lexer.next();
+      exp = func;
+      advance();
       return exp;
     } else if (curr.type == TOKEN_TYPE::DOT) {
       //.Identifier
       requireNext(TOKEN_TYPE::IDEN);
-      std::unique_ptr<Expr> getter =
-          std::make_unique<Expr>(curr.sourceLocation, nullptr, GetExpr{});
-      getter->getGetExpr()->expr = std::move(exp);
-      getter->getGetExpr()->name.name = curr.text;
-      exp = std::move(getter);
-      curr = lexer.next();
+      Expr* getter = arena->make<Expr>(location(), nullptr, GetExpr{});
+      getter->getGetExpr()->expr = exp;
+      getter->getGetExpr()->name.name = symbol();
+      exp = getter;
+      advance();
     } else {
       break;
     }
@@ -943,63 +1334,63 @@ std::string fixer(const std::string_view orig) {
   return returner;
 }
 // Deal with primary tokens, return the proper expression
-std::unique_ptr<Expr> Parser::primary() {
+Expr* Parser::primary() {
   switch (curr.type) {
     // Int
     case TOKEN_TYPE::INT: {
       int val{};
-      auto result = std::from_chars(curr.text.data(),
-                                    curr.text.data() + curr.text.size(), val);
+      auto result = std::from_chars(text().data(),
+                                    text().data() + text().size(), val);
       if (result.ec == std::errc::invalid_argument) {
-        std::cerr << "Could not convert to int at: " << curr.sourceLocation.line
-                  << ":" << curr.sourceLocation.character << ".\n";
+        *errors << "Could not convert to int at: " << location().line
+                  << ":" << location().character << ".\n";
         return {};
       }
-      std::unique_ptr<Expr> expr = std::make_unique<Expr>(
-          Expr::makeInt(curr, program->bottomTypes.intType, val));
-      curr = lexer.next();
+      Expr* expr = arena->make<Expr>(
+          Expr::makeInt(location(), program->bottomTypes.intType, val));
+      advance();
       return expr;
     }
     // Float
     case TOKEN_TYPE::FLOAT: {
       double val{};
-      auto result = std::from_chars(curr.text.data(),
-                                    curr.text.data() + curr.text.size(), val);
+      auto result = std::from_chars(text().data(),
+                                    text().data() + text().size(), val);
       if (result.ec == std::errc::invalid_argument) {
-        std::cerr << "Could not convert to int at: " << curr.sourceLocation.line
-                  << ":" << curr.sourceLocation.character << ".\n";
+        *errors << "Could not convert to int at: " << location().line
+                  << ":" << location().character << ".\n";
         return {};
       }
-      std::unique_ptr<Expr> expr = std::make_unique<Expr>(
-          Expr::makeFloat(curr, program->bottomTypes.floatType, val));
-      curr = lexer.next();
+      Expr* expr = arena->make<Expr>(
+          Expr::makeFloat(location(), program->bottomTypes.floatType, val));
+      advance();
       return expr;
     }
     // Left paren
     case TOKEN_TYPE::LEFT_PAREN: {
-      curr = lexer.next();
+      advance();
       auto result = expr();
       if (curr.type != TOKEN_TYPE::RIGHT_PAREN) {
-        std::cerr << "Parentheses not closed at: " << curr.sourceLocation.line
-                  << ":" << curr.sourceLocation.character << '\n';
+        *errors << "Parentheses not closed at: " << location().line
+                  << ":" << location().character << '\n';
         return {};
       }
-      curr = lexer.next();
+      advance();
       return result;
     }
     // Char
     case TOKEN_TYPE::CHAR: {
       // Regular character
-      if (curr.text.size() == 3) {
-        char c = curr.text.at(1);
-        std::unique_ptr<Expr> returner = std::make_unique<Expr>(
-            curr.sourceLocation, program->bottomTypes.charType, CharExpr(c));
-        curr = lexer.next();
+      if (text().size() == 3) {
+        char c = text().at(1);
+        Expr* returner = arena->make<Expr>(
+            location(), program->bottomTypes.charType, CharExpr(c));
+        advance();
         return returner;
-      } else if (curr.text.size() == 4) {
+      } else if (text().size() == 4) {
         // Escape sequences
         char c;
-        switch (curr.text.at(2)) {
+        switch (text().at(2)) {
           case 'a':
             c = '\a';
             break;
@@ -1036,75 +1427,74 @@ std::unique_ptr<Expr> Parser::primary() {
           default:
             c = 0;
         }
-        std::unique_ptr<Expr> returner = std::make_unique<Expr>(
-            curr.sourceLocation, program->bottomTypes.charType, CharExpr(c));
-        curr = lexer.next();
+        Expr* returner = arena->make<Expr>(
+            location(), program->bottomTypes.charType, CharExpr(c));
+        advance();
         return returner;
       } else {
         // Hexadecimal
-        char c = std::stoi(std::string{curr.text.substr(3, 2)}, 0, 16);
-        std::unique_ptr<Expr> returner = std::make_unique<Expr>(
-            curr.sourceLocation, program->bottomTypes.charType, CharExpr(c));
-        curr = lexer.next();
+        char c = std::stoi(std::string{text().substr(3, 2)}, 0, 16);
+        Expr* returner = arena->make<Expr>(
+            location(), program->bottomTypes.charType, CharExpr(c));
+        advance();
         return returner;
       }
     }
     // String
     case TOKEN_TYPE::STRING: {
-      std::string correct = fixer(curr.text);
-      std::unique_ptr<Expr> returner = std::make_unique<Expr>(
-          curr.sourceLocation,
-          std::make_shared<Type>(
-              ListType(correct.size(), program->bottomTypes.charType),
-              std::vector<std::shared_ptr<Impl>>{}),
-          StringExpr(std::string{correct}));
-      curr = lexer.next();
+      std::string correct = fixer(text());
+      Expr* returner = arena->make<Expr>(
+          location(),
+          program->types->list(static_cast<int>(correct.size()),
+                               program->bottomTypes.charType),
+          arena->make<StringExpr>(correct));
+      advance();
       return returner;
     }
     // Identifier
     case TOKEN_TYPE::IDEN: {
-      std::unique_ptr<Expr> returner = std::make_unique<Expr>(
-          curr.sourceLocation, program->bottomTypes.voidType,
-          LiteralExpr(curr.text));
-      curr = lexer.next();
+      Expr* returner = arena->make<Expr>(
+          location(), program->bottomTypes.voidType,
+          LiteralExpr(symbol()));
+      advance();
       return returner;
     }
     // true
     case TOKEN_TYPE::TRUE: {
-      std::unique_ptr<Expr> exp = std::make_unique<Expr>(
-          curr.sourceLocation, program->bottomTypes.boolType, BoolExpr{true});
-      curr = lexer.next();
+      Expr* exp = arena->make<Expr>(
+          location(), program->bottomTypes.boolType, BoolExpr{true});
+      advance();
       return exp;
     }
     // false
     case TOKEN_TYPE::FALSE: {
-      std::unique_ptr<Expr> exp = std::make_unique<Expr>(
-          curr.sourceLocation, program->bottomTypes.boolType, BoolExpr{false});
-      curr = lexer.next();
+      Expr* exp = arena->make<Expr>(
+          location(), program->bottomTypes.boolType, BoolExpr{false});
+      advance();
       return exp;
     }
     // self
     case TOKEN_TYPE::SELF: {
       if (isImplClass != state::NORMAL) {
-        std::unique_ptr<Expr> returner = std::make_unique<Expr>(
-            curr.sourceLocation, program->bottomTypes.selfType,
-            LiteralExpr(curr.text));
-        curr = lexer.next();
+        Expr* returner = arena->make<Expr>(
+            location(), program->bottomTypes.selfType,
+            LiteralExpr(symbol()));
+        advance();
         return returner;
       } else {
-        std::cerr << "SELF cannot exist outside of an Impl or Class\n.";
+        *errors << "SELF cannot exist outside of an Impl or Class\n.";
         return nullptr;
       }
     }
     case TOKEN_TYPE::VOID: {
-      auto returner = std::make_unique<Expr>(curr.sourceLocation, program->bottomTypes.voidType, VoidExpr{});
-      curr = lexer.next();
+      auto returner = arena->make<Expr>(location(), program->bottomTypes.voidType, VoidExpr{});
+      advance();
       return returner;
     }
     default:
       // Otherwise, token is invalid
-      std::cerr << "Invalid token at: " << curr.sourceLocation.line << ":"
-                << curr.sourceLocation.character << "!\n";
+      *errors << "Invalid token at: " << location().line << ":"
+                << location().character << "!\n";
       return {};
   }
 }
@@ -2,15 +2,24 @@
 #ifndef INCLUDE_SENIORPROJECT_PARSER_H_
 #define INCLUDE_SENIORPROJECT_PARSER_H_
 
+#include <cstdint>
+#include <iostream>
 #include <memory>
 #include <optional>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "arena.h"
 #include "environment.h"
 #include "expr.h"
 #include "lexer.h"
 #include "stmt.h"
+#include "symbol.h"
 #include "token.h"
+#include "type_context.h"
 #include "types.h"
 // Parser class - analyze tokens
 class Parser {
@@ -18,6 +27,29 @@ class Parser {
   // State of parser
   enum class state { NORMAL, IMPL, CLASS };
   state isImplClass = Parser::state::NORMAL;
+  // Binding power of the infix operators, loosest first
+  enum Power : uint8_t {
+    kNone,
+    kAssign,
+    kRange,
+    kOr,
+    kAnd,
+    kBitOr,
+    kXor,
+    kBitAnd,
+    kEquate,
+    kRelation,
+    kShift,
+    kAdd,
+    kMult,
+    kStrongest = kMult
+  };
+  static Power infixPower(TOKEN_TYPE type);
+  const Token& peek(size_t k = 1) const;
+  void advance();
+  std::string_view text() const;
+  Symbol symbol() const;
+  SourceLocation location();
   bool requireNext(TOKEN_TYPE type);
   bool munch(TOKEN_TYPE type);
   bool eatCurr(TOKEN_TYPE type);
@@ -27,24 +59,119 @@ class Parser {
  public:
   // Parser types
   enum class parser { PROGRAM, EXPR, TYPE };
+  // Arena every node is made in - owned by the outermost parser and
+  // borrowed by parsers of nested environments
+  std::unique_ptr<Arena> ownedArena;
+  std::unique_ptr<TypeContext> ownedTypes;
+  Arena* arena = nullptr;
   // Program environment
-  std::unique_ptr<Environment> program;
-  // Constructors - use a lexer
-  explicit Parser(Lexer lexer) : lexer(std::move(lexer)) { setup(); }
+  Environment* program = nullptr;
+  // Constructors - use a lexer, which is run to the end up front
+  explicit Parser(Lexer lexer)
+      : ownedArena(std::make_unique<Arena>()),
+        ownedTypes(std::make_unique<TypeContext>()),
+        arena(ownedArena.get()),
+        tokens(std::make_shared<std::vector<Token>>(
+            lexer.tokenizeParallel())),
+        source(lexer.sourceMap()) {
+    setup();
+  }
   Parser(Lexer lexer, Environment* program)
-      : program(program), lexer(std::move(lexer)){};
+      : arena(program->arena),
+        program(program),
+        tokens(std::make_shared<std::vector<Token>>(
+            lexer.tokenizeParallel())),
+        source(lexer.sourceMap()){};
   Parser(Parser&& parser)
-      : program(std::move(parser.program)), lexer(parser.lexer), curr(parser.curr) {}
+      : ownedArena(std::move(parser.ownedArena)),
+        ownedTypes(std::move(parser.ownedTypes)),
+        arena(parser.arena),
+        program(parser.program),
+        workerArenas(std::move(parser.workerArenas)),
+        tokens(std::move(parser.tokens)),
+        source(std::move(parser.source)),
+        spans(std::move(parser.spans)),
+        index(parser.index),
+        lineHint(parser.lineHint),
+        curr(parser.curr) {}
   Parser(const Parser& parser)
-      : program(parser.program->clone()), lexer(parser.lexer), curr(parser.curr) {}
+      : arena(parser.arena),
+        program(parser.program->clone()),
+        tokens(parser.tokens),
+        source(parser.source),
+        index(parser.index),
+        lineHint(parser.lineHint),
+        curr(parser.curr) {}
   // Default destructor
   ~Parser() = default;
-  std::unique_ptr<Environment> parse(parser is = Parser::parser::PROGRAM);
+  // Parse the input; the result lives as long as the parser's arena
+  Environment* parse(parser is = Parser::parser::PROGRAM);
+  // As parse(), with the let and const globals parsed on worker threads
+  // (0 means one per core), each into its own arena. Results are added in
+  // source order, so the program and the diagnostics match parse()'s. Small
+  // inputs are parsed on this thread
+  Environment* parseParallel(unsigned threads = 0);
+  // Follow an edit of the input - removed bytes at offset replaced by text -
+  // after a parse of the program. Only tokens and globals near the edit are
+  // lexed and parsed again, and other globals are kept as they were, so the
+  // program matches a parse() of the edited input, once settleLines() has
+  // been called. Diagnostics are only written for the globals parsed again
+  Environment* reparse(size_t offset, size_t removed, std::string_view text);
+  // Move the nodes of globals kept by reparse() to the lines the edits since
+  // the last call put them on. reparse() only counts how far each has moved,
+  // so a run of edits walks a kept global once, and not at all if its moves
+  // cancel out
+  Environment* settleLines();
 
  private:
+  // Arenas of the worker threads, which live as long as this parser
+  std::vector<std::unique_ptr<Arena>> workerArenas;
+  // Parser for a worker thread - reads the tokens of parent, and makes nodes
+  // in its own arena
+  Parser(const Parser& parent, Arena* arena)
+      : arena(arena),
+        program(parent.program),
+        tokens(parent.tokens),
+        source(parent.source) {}
   void setup();
-  // Lexer, current token
-  Lexer lexer;
+  // Every token of the input and the map for their text and locations
+  std::shared_ptr<std::vector<Token>> tokens;
+  std::shared_ptr<SourceMap> source;
+  // Where diagnostics go
+  std::ostream* errors = &std::cerr;
+  // Globals by name, with where they are first defined - worker threads look
+  // globals up here, and only see those before the one they are parsing
+  using GlobalTable = std::unordered_map<Symbol, std::pair<size_t, Stmt*>>;
+  const GlobalTable* globalTable = nullptr;
+  size_t globalIndex = 0;
+  // Tokens [first, end) of each global of the program in order, with the name
+  // it was added under (empty if it was not), for reparse()
+  struct GlobalSpan {
+    size_t first;
+    size_t end;
+    size_t seen;  // Last token this or an earlier global looked at
+    Symbol name;
+    bool defines;       // The member under name, not a redefinition
+    bool declaresType;  // A type, class, or impl, which others may look up
+    int lines;          // Lines its nodes are yet to move by
+  };
+  std::vector<GlobalSpan> spans;
+  // Globals of the program by where they are first defined, for reparse(),
+  // and the members array they point into
+  GlobalTable definitions;
+  const Stmt* definedIn = nullptr;
+  void addDefinitions(size_t from);
+  Stmt* lookup(Symbol name);
+  // Scopes of the environments nested in the program being parsed
+  ScopedTable scopes;
+  Environment* innerEnvironment();
+  void outerEnvironment(Environment* prev);
+  void declare(Symbol name, Stmt member);
+  // Index of the current token, line it was last located on, and a copy of it
+  size_t index = 0;
+  // Furthest token looked at since it was last reset
+  mutable size_t furthest = 0;
+  size_t lineHint = 0;
   Token curr;
   std::optional<Stmt> typeDef();
   std::shared_ptr<Type> type();
@@ -56,38 +183,29 @@ class Parser {
   std::optional<Stmt> stmt();
   std::optional<Stmt> returnStmt();
   std::optional<Stmt> yieldStmt();
-  std::unique_ptr<Expr> functionExpr();
+  Expr* functionExpr();
   std::optional<Stmt> exprStmt();
   std::optional<Stmt> implStmt();
   std::optional<Stmt> declarationStmt();
   std::optional<Stmt> classStmt();
-  std::unique_ptr<Expr> rangeExpr();
-  std::unique_ptr<Expr> expr();
-  std::unique_ptr<Expr> assign();
-  std::unique_ptr<Expr> orExpr();
-  std::unique_ptr<Expr> andExpr();
-  std::unique_ptr<Expr> bitAndExpr();
-  std::unique_ptr<Expr> equateExpr();
-
-  std::unique_ptr<Expr> xorExpr();
-  std::unique_ptr<Expr> bitOrExpr();
-  std::unique_ptr<Expr> relation();
-  std::unique_ptr<Expr> shift();
-  std::unique_ptr<Expr> add();
-  std::unique_ptr<Expr> mult();
-  std::unique_ptr<Expr> primary();
-  std::unique_ptr<Expr> access();
-  std::unique_ptr<Expr> ifExpr();
-  std::unique_ptr<Expr> forExpr();
-  std::unique_ptr<Expr> matchExpr();
-  std::unique_ptr<Expr> whileExpr();
-  std::unique_ptr<Expr> block();
-  std::unique_ptr<Expr> negate();
-  std::unique_ptr<Expr> notExpr();
+  Expr* expr();
+  Expr* assign();
+  Expr* binary(Power minPower, Power& reach);
+  Expr* prefix();
+  Expr* primary();
+  Expr* access();
+  Expr* ifExpr();
+  Expr* forExpr();
+  Expr* matchExpr();
+  Expr* whileExpr();
+  Expr* block();
   std::optional<Stmt> forConditionExpr();
   std::shared_ptr<Type> productType();
   std::optional<Stmt> globals();
+  std::optional<Stmt> global();
+  void addGlobal(std::optional<Stmt> global, size_t first);
   CaseExpr caseExpr();
+  bool typeCase() const;
 };
 
 #endif  // INCLUDE_SENIORPROJECT_PARSER_H_
@@ -0,0 +1,226 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_RESOLVER_H_
+#define INCLUDE_SRC_RESOLVER_H_
+#include <cstdint>
+#include <vector>
+
+#include "environment.h"
+#include "expr.h"
+#include "stmt.h"
+#include "symbol_index.h"
+
+// Resolver - bind every name to its declaration, once, after parsing. Each
+// literal gets the depth and slot of what it names, each function the
+// declarations of its locals, and each declaration its slot, so that later
+// passes index arrays rather than look names up. The value of a global, field
+// or method is a frame of its own, like a function, for the lets in it
+// outside any function. The globals each global names are kept in the
+// program, for checking globals in parallel. Run again after the program is
+// reparsed
+class Resolver : public ExprVisitor<Resolver, void>,
+                 public StmtVisitor<Resolver, void> {
+ public:
+  explicit Resolver(Environment* program) : program(program) {}
+  // Resolve every global - globals are all visible to each other
+  void resolve() {
+    for (uint32_t slot = 0; slot < program->members.size(); ++slot) {
+      Stmt& global = program->members[slot];
+      if (global.isDeclarationStmt()) global.getDeclarationStmt()->slot = slot;
+    }
+    program->uses.clear();
+    program->usesBegin.assign(1, 0);
+    usedBy.assign(program->members.size(), SymbolIndex::kNone);
+    for (current = 0; current < program->members.size(); ++current) {
+      _visitStmt(&program->members[current]);
+      program->usesBegin.push_back(
+          static_cast<uint32_t>(program->uses.size()));
+    }
+  }
+  // Globals are in the program, not bound as locals
+  void visitDeclarationStmt(Stmt* stmt) {
+    bool local = !frames.empty();
+    visitValueOf(stmt->getDeclarationStmt());
+    if (local) declare(stmt);
+  }
+  void visitReturnStmt(Stmt* stmt) { visitValue(stmt->getReturnStmt()->val); }
+  void visitYieldStmt(Stmt* stmt) { visitValue(stmt->getYieldStmt()->val); }
+  void visitExprStmt(Stmt* stmt) { visitValue(stmt->getExprStmt()->val); }
+  // Fields and methods are not in scope as names, only their values are
+  void visitClassStmt(Stmt* stmt) {
+    for (Stmt& field : stmt->getClassStmt()->parameters) {
+      visitValueOf(field.getDeclarationStmt());
+    }
+  }
+  void visitImplStmt(Stmt* stmt) {
+    for (Stmt& method : stmt->getImplStmt()->parameters) {
+      visitValueOf(method.getDeclarationStmt());
+    }
+  }
+  void visitContinueStmt(Stmt*) {}
+  void visitTypeDef(Stmt*) {}
+  // Left operands of a long chain are walked in a loop, not recursively
+  void visitBinaryExpr(Expr* expr) {
+    size_t base = rights.size();
+    Expr* leftmost = expr;
+    for (; leftmost->isBinaryExpr();
+         leftmost = leftmost->getBinaryExpr()->left) {
+      rights.push_back(leftmost->getBinaryExpr()->right);
+    }
+    _visitExpr(leftmost);
+    while (rights.size() > base) {
+      Expr* right = rights.back();
+      rights.pop_back();
+      _visitExpr(right);
+    }
+  }
+  void visitPrefixExpr(Expr* expr) { _visitExpr(expr->getPrefixExpr()->expr); }
+  void visitLiteralExpr(Expr* expr) {
+    LiteralExpr* literal = expr->getLiteralExpr();
+    uint32_t head = heads.find(literal->name, nameOf());
+    if (head != SymbolIndex::kNone) {
+      literal->declaration = bindings[head].ref;
+    } else {
+      uint32_t slot = program->slotOf(literal->name);
+      literal->declaration = DeclarationRef{0, slot};
+      use(slot);
+    }
+  }
+  // Parameters take the first slots of a function's locals
+  void visitFunctionExpr(Expr* expr) {
+    FunctionExpr* function = expr->getFunctionExpr();
+    function->locals.clear();
+    frames.push_back(&function->locals);
+    size_t mark = bindings.size();
+    for (Stmt& param : function->parameters->members) declare(&param);
+    _visitExpr(function->action);
+    unbind(mark);
+    frames.pop_back();
+  }
+  void visitBlockExpr(Expr* expr) {
+    size_t mark = bindings.size();
+    for (Stmt* stmt : expr->getBlockExpr()->stmts) _visitStmt(stmt);
+    unbind(mark);
+  }
+  // The range is outside the loop variable's scope
+  void visitForExpr(Expr* expr) {
+    std::pmr::vector<Stmt>& vars = expr->getForExpr()->env->members;
+    for (Stmt& var : vars) visitValue(var.getDeclarationStmt()->val);
+    size_t mark = bindings.size();
+    for (Stmt& var : vars) declare(&var);
+    _visitExpr(expr->getForExpr()->body);
+    unbind(mark);
+  }
+  void visitWhileExpr(Expr* expr) {
+    _visitExpr(expr->getWhileExpr()->cond);
+    _visitExpr(expr->getWhileExpr()->body);
+  }
+  void visitIfExpr(Expr* expr) {
+    _visitExpr(expr->getIfExpr()->cond);
+    _visitExpr(expr->getIfExpr()->thenExpr);
+    visitValue(expr->getIfExpr()->elseExpr);
+  }
+  void visitMatchExpr(Expr* expr) {
+    _visitExpr(expr->getMatchExpr()->cond);
+    for (CaseExpr& caser : expr->getMatchExpr()->cases) {
+      if (caser.isExprCond()) _visitExpr(caser.getExpr());
+      _visitExpr(caser.body);
+    }
+  }
+  // Field names are left to the type checker
+  void visitGetExpr(Expr* expr) { _visitExpr(expr->getGetExpr()->expr); }
+  void visitCallExpr(Expr* expr) {
+    _visitExpr(expr->getCallExpr()->expr);
+    for (Expr* param : expr->getCallExpr()->params) visitValue(param);
+  }
+  void visitTypeConvExpr(Expr* expr) {
+    visitValue(expr->getTypeConvExpr()->expr);
+  }
+  void visitIntExpr(Expr*) {}
+  void visitFloatExpr(Expr*) {}
+  void visitBoolExpr(Expr*) {}
+  void visitCharExpr(Expr*) {}
+  void visitStringExpr(Expr*) {}
+  void visitVoidExpr(Expr*) {}
+  void enterExprVisitor() {}
+  void exitExprVisitor() {}
+  void enterStmtVisitor() {}
+  void exitStmtVisitor() {}
+
+ private:
+  struct Binding {
+    Symbol name;
+    DeclarationRef ref;
+    uint32_t shadowed;  // Binding of the name before this one, or kNone
+  };
+  struct NameOf {
+    const Resolver* resolver;
+    Symbol operator()(uint32_t at) const {
+      return resolver->bindings[at].name;
+    }
+  };
+  NameOf nameOf() const { return NameOf{this}; }
+  void visitValue(Expr* expr) {
+    if (expr) _visitExpr(expr);
+  }
+  // Resolve the value of a declaration - in a frame of its own, outside any
+  // other, as for a global, field or method
+  void visitValueOf(DeclarationStmt* declaration) {
+    if (!frames.empty()) {
+      visitValue(declaration->val);
+      return;
+    }
+    declaration->locals.clear();
+    frames.push_back(&declaration->locals);
+    visitValue(declaration->val);
+    frames.pop_back();
+  }
+  // Give a local the next slot of the innermost frame, and bind its name
+  // there, shadowing any outer one (and an earlier let of the same name)
+  void declare(Stmt* stmt) {
+    std::vector<Stmt*>& locals = *frames.back();
+    auto slot = static_cast<uint32_t>(locals.size());
+    locals.push_back(stmt);
+    stmt->getDeclarationStmt()->slot = slot;
+    bind(stmt->getDeclarationStmt()->name,
+         DeclarationRef{static_cast<uint32_t>(frames.size()), slot});
+  }
+  // Note that the global being resolved names the one at slot, once
+  void use(uint32_t slot) {
+    if (slot == SymbolIndex::kNone || slot == current ||
+        usedBy[slot] == current)
+      return;
+    usedBy[slot] = current;
+    program->uses.push_back(slot);
+  }
+  void bind(Symbol name, DeclarationRef ref) {
+    bindings.push_back(Binding{name, ref, heads.find(name, nameOf())});
+    heads.set(name, static_cast<uint32_t>(bindings.size() - 1), nameOf());
+  }
+  // Undo the bindings made since mark, newest first
+  void unbind(size_t mark) {
+    while (bindings.size() > mark) {
+      const Binding& binding = bindings.back();
+      if (binding.shadowed == SymbolIndex::kNone) {
+        heads.erase(binding.name, nameOf());
+      } else {
+        heads.set(binding.name, binding.shadowed, nameOf());
+      }
+      bindings.pop_back();
+    }
+  }
+  Environment* program;
+  // Locals of each frame being resolved, outermost first - the value of a
+  // global, field or method, then the functions in it
+  std::vector<std::vector<Stmt*>*> frames;
+  // Locals in scope, oldest first, and the newest of each name; globals are
+  // found in the program
+  std::vector<Binding> bindings;
+  SymbolIndex heads;
+  // Slot of the global being resolved, and the last global to name each
+  uint32_t current = 0;
+  std::vector<uint32_t> usedBy;
+  // Right operands visitBinaryExpr has yet to visit
+  std::vector<Expr*> rights;
+};
+
+#endif  // INCLUDE_SRC_RESOLVER_H_
@@ -0,0 +1,173 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#include "scan.h"
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SCAN_HAVE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// AVX2 versions are compiled with a target attribute and only called when
+// the CPU reports support, so the rest of the build stays baseline x86-64
+#define SCAN_HAVE_AVX2 1
+#define SCAN_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+// Character classes, matching the ones the lexer uses
+static bool isWhitespace(const char t) {
+  return t == ' ' || t == '\t' || t == '\r' || t == '\n';
+}
+static bool isIdentifier(const char t) {
+  return t == '_' || (t >= 'a' && t <= 'z') || (t >= 'A' && t <= 'Z') ||
+         (t >= '0' && t <= '9');
+}
+static bool isDigit(const char t) { return t >= '0' && t <= '9'; }
+
+// Portable kernels, also used for the tails of the vector ones
+static size_t scalarWhitespace(const char* text, size_t len) {
+  size_t i = 0;
+  while (i < len && isWhitespace(text[i])) ++i;
+  return i;
+}
+static size_t scalarIdentifier(const char* text, size_t len) {
+  size_t i = 0;
+  while (i < len && isIdentifier(text[i])) ++i;
+  return i;
+}
+static size_t scalarDigits(const char* text, size_t len) {
+  size_t i = 0;
+  while (i < len && isDigit(text[i])) ++i;
+  return i;
+}
+static size_t scalarQuote(const char* text, size_t len) {
+  size_t i = 0;
+  while (i < len && text[i] != '"') ++i;
+  return i;
+}
+
+#ifdef SCAN_HAVE_SSE2
+// Bytes of a 16 byte block that are in [lo, hi]. Every range we test lies in
+// 0-127, so signed compares also reject bytes with the high bit set
+static __m128i inRange16(__m128i block, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(lo - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), block));
+}
+static __m128i whitespace16(__m128i block) {
+  return _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                   _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+      _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')),
+                   _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+}
+static __m128i digits16(__m128i block) { return inRange16(block, '0', '9'); }
+static __m128i identifier16(__m128i block) {
+  // Setting bit 5 folds A-Z onto a-z without pulling any other byte into it
+  __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+  return _mm_or_si128(
+      _mm_or_si128(inRange16(lower, 'a', 'z'), digits16(block)),
+      _mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+}
+// Length of the leading run of bytes for which match sets the lane
+template <__m128i (*match)(__m128i), size_t (*tail)(const char*, size_t)>
+static size_t run16(const char* text, size_t len) {
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+    uint32_t miss = ~static_cast<uint32_t>(_mm_movemask_epi8(match(block))) &
+                    0xFFFFu;
+    if (miss) return i + std::countr_zero(miss);
+  }
+  return i + tail(text + i, len - i);
+}
+static size_t sse2Quote(const char* text, size_t len) {
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+    uint32_t hit = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('"'))));
+    if (hit) return i + std::countr_zero(hit);
+  }
+  return i + scalarQuote(text + i, len - i);
+}
+#endif  // SCAN_HAVE_SSE2
+
+#ifdef SCAN_HAVE_AVX2
+SCAN_AVX2 static __m256i inRange32(__m256i block, char lo, char hi) {
+  return _mm256_and_si256(
+      _mm256_cmpgt_epi8(block, _mm256_set1_epi8(lo - 1)),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), block));
+}
+SCAN_AVX2 static __m256i whitespace32(__m256i block) {
+  return _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+                      _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+      _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r')),
+                      _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n'))));
+}
+SCAN_AVX2 static __m256i digits32(__m256i block) {
+  return inRange32(block, '0', '9');
+}
+SCAN_AVX2 static __m256i identifier32(__m256i block) {
+  __m256i lower = _mm256_or_si256(block, _mm256_set1_epi8(0x20));
+  return _mm256_or_si256(
+      _mm256_or_si256(inRange32(lower, 'a', 'z'), digits32(block)),
+      _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')));
+}
+template <__m256i (*match)(__m256i), size_t (*tail)(const char*, size_t)>
+SCAN_AVX2 static size_t run32(const char* text, size_t len) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+    uint32_t miss = ~static_cast<uint32_t>(_mm256_movemask_epi8(match(block)));
+    if (miss) return i + std::countr_zero(miss);
+  }
+  // The remaining bytes are fewer than one AVX2 block; the tail kernel is the
+  // SSE2 one, which finishes with the scalar loop
+  return i + tail(text + i, len - i);
+}
+SCAN_AVX2 static size_t avx2Quote(const char* text, size_t len) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+    uint32_t hit = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('"'))));
+    if (hit) return i + std::countr_zero(hit);
+  }
+  return i + sse2Quote(text + i, len - i);
+}
+#endif  // SCAN_HAVE_AVX2
+
+const ScanKernels& scalarScanKernels() {
+  static const ScanKernels kernels{scalarWhitespace, scalarIdentifier,
+                                   scalarDigits, scalarQuote, "scalar"};
+  return kernels;
+}
+const ScanKernels& scanKernels() {
+#ifdef SCAN_HAVE_AVX2
+  static const ScanKernels avx2{
+      run32<whitespace32, run16<whitespace16, scalarWhitespace>>,
+      run32<identifier32, run16<identifier16, scalarIdentifier>>,
+      run32<digits32, run16<digits16, scalarDigits>>,
+      avx2Quote,
+      "avx2"};
+  if (__builtin_cpu_supports("avx2")) return avx2;
+#endif
+#ifdef SCAN_HAVE_SSE2
+  // SSE2 is part of the x86-64 baseline, so no check is needed
+  static const ScanKernels sse2{run16<whitespace16, scalarWhitespace>,
+                                run16<identifier16, scalarIdentifier>,
+                                run16<digits16, scalarDigits>,
+                                sse2Quote,
+                                "sse2"};
+  return sse2;
+#else
+  return scalarScanKernels();
+#endif
+}
@@ -0,0 +1,28 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_SCAN_H_
+#define INCLUDE_SRC_SCAN_H_
+
+#include <cstddef>
+
+// Byte-run scanners used by the lexer. Each one looks at up to len bytes
+// starting at text and returns how many bytes belong to the run (len if the
+// run reaches the end). Vector versions handle 16 (SSE2) or 32 (AVX2) bytes
+// per step; the best one for the running CPU is picked once at startup.
+struct ScanKernels {
+  // Length of the leading run of ' ', '\t', '\r' and '\n'
+  size_t (*whitespace)(const char* text, size_t len);
+  // Length of the leading run of [A-Za-z0-9_]
+  size_t (*identifier)(const char* text, size_t len);
+  // Length of the leading run of [0-9]
+  size_t (*digits)(const char* text, size_t len);
+  // Index of the first '"', or len if there is none
+  size_t (*quote)(const char* text, size_t len);
+  // Name of the instruction set, for debugging
+  const char* name;
+};
+// Return the kernels for the running CPU
+const ScanKernels& scanKernels();
+// Return the portable byte-at-a-time kernels
+const ScanKernels& scalarScanKernels();
+
+#endif  // INCLUDE_SRC_SCAN_H_
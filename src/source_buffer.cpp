@@ -0,0 +1,85 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#include "source_buffer.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+// No mapping on Windows - read the file, or stdin for "-", in one go
+SourceBuffer::SourceBuffer(const char* path) {
+  if (std::strcmp(path, "-") == 0) {
+    copy.assign(std::istreambuf_iterator<char>(std::cin), {});
+  } else {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      std::cerr << "Cannot open " << path << ".\n";
+      exit(-1);
+    }
+    copy.assign(std::istreambuf_iterator<char>(file), {});
+  }
+  data = copy.data();
+  size = copy.size();
+}
+SourceBuffer::~SourceBuffer() = default;
+#else
+// Map regular files, otherwise read until end of file
+SourceBuffer::SourceBuffer(const char* path) {
+  bool isStdin = std::strcmp(path, "-") == 0;
+  int fd = isStdin ? STDIN_FILENO : open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Cannot open " << path << ": " << std::strerror(errno)
+              << ".\n";
+    exit(-1);
+  }
+  struct stat info {};
+  bool regular = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+  // Empty files cannot be mapped, and have nothing to read
+  if (regular && info.st_size > 0) {
+    void* mapping =
+        mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      // The lexer makes one forward pass, so read ahead aggressively
+      madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+      data = static_cast<const char*>(mapping);
+      size = info.st_size;
+      mapped = true;
+      if (!isStdin) close(fd);
+      return;
+    }
+  }
+  // Read into one buffer, sized up front when the size is known
+  copy.resize(regular && info.st_size > 0 ? info.st_size : 64 * 1024);
+  size_t used = 0;
+  for (;;) {
+    if (used == copy.size()) copy.resize(copy.size() * 2);
+    ssize_t got = read(fd, copy.data() + used, copy.size() - used);
+    if (got < 0 && errno == EINTR) continue;
+    if (got < 0) {
+      std::cerr << "Cannot read " << path << ": " << std::strerror(errno)
+                << ".\n";
+      exit(-1);
+    }
+    if (got == 0) break;
+    used += got;
+  }
+  copy.resize(used);
+  if (!isStdin) close(fd);
+  data = copy.data();
+  size = copy.size();
+}
+SourceBuffer::~SourceBuffer() {
+  if (mapped) munmap(const_cast<char*>(data), size);
+}
+#endif
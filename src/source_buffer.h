@@ -0,0 +1,31 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_SOURCE_BUFFER_H_
+#define INCLUDE_SRC_SOURCE_BUFFER_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+// Source buffer - the whole contents of an input file. Regular files are
+// mapped read-only so the lexer reads the page cache directly; stdin ("-"),
+// pipes and anything else that cannot be mapped are read once into memory
+class SourceBuffer {
+ public:
+  // Open and load a path, exiting with a message if it cannot be read
+  explicit SourceBuffer(const char* path);
+  SourceBuffer(const SourceBuffer&) = delete;
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+  ~SourceBuffer();
+  // Return the contents, valid while the buffer lives
+  std::string_view view() const { return {data, size}; }
+  // Return true if the contents are a mapping rather than a copy
+  bool isMapped() const { return mapped; }
+
+ private:
+  const char* data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  // Holds the contents when they could not be mapped
+  std::string copy;
+};
+
+#endif  // INCLUDE_SRC_SOURCE_BUFFER_H_
@@ -0,0 +1,93 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#include "source_map.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+// Find the start of every line
+SourceMap::SourceMap(std::string_view input) : input(input) {
+  // Offsets are 32 bits in tokens
+  if (input.size() > std::numeric_limits<uint32_t>::max()) {
+    std::cerr << "Input files are limited to 4 GiB.\n";
+    exit(-1);
+  }
+  lineStarts.push_back(0);
+  const char* begin = input.data();
+  const char* end = begin + input.size();
+  for (const char* at = begin; at < end;) {
+    const void* newline = std::memchr(at, '\n', end - at);
+    if (!newline) break;
+    at = static_cast<const char*>(newline) + 1;
+    lineStarts.push_back(static_cast<uint32_t>(at - begin));
+  }
+}
+// Look up the text of a token, and the true length of a long one
+std::string_view SourceMap::text(const Token& token) const {
+  size_t length = token.length;
+  if (length == Token::kLongToken) length = longTokens.at(token.offset);
+  return input.substr(token.offset, length);
+}
+// Binary search for the last line starting at or before offset
+SourceLocation SourceMap::locate(uint32_t offset) const {
+  size_t line =
+      std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) -
+      lineStarts.begin() - 1;
+  return SourceLocation{static_cast<int>(line + 1),
+                        static_cast<int>(offset - lineStarts[line] + 1)};
+}
+// Check the hinted line and the one after before searching
+SourceLocation SourceMap::locate(uint32_t offset, size_t& lineHint) const {
+  for (size_t line = lineHint; line < lineHint + 2 && line < lineStarts.size();
+       ++line) {
+    if (lineStarts[line] > offset) break;
+    if (line + 1 == lineStarts.size() || lineStarts[line + 1] > offset) {
+      lineHint = line;
+      return SourceLocation{static_cast<int>(line + 1),
+                            static_cast<int>(offset - lineStarts[line] + 1)};
+    }
+  }
+  SourceLocation location = locate(offset);
+  lineHint = location.line - 1;
+  return location;
+}
+void SourceMap::addLongToken(uint32_t offset, size_t length) {
+  std::lock_guard<std::mutex> guard(longTokensLock);
+  longTokens[offset] = static_cast<uint32_t>(length);
+}
+// Splice the line starts of the new text in, and move the ones after it
+void SourceMap::edit(size_t offset, size_t removed, std::string_view text) {
+  if (input.data() != edited.data()) edited.assign(input);
+  edited.replace(offset, removed, text);
+  if (edited.size() > std::numeric_limits<uint32_t>::max()) {
+    std::cerr << "Input files are limited to 4 GiB.\n";
+    exit(-1);
+  }
+  input = edited;
+  int64_t delta = static_cast<int64_t>(text.size()) - removed;
+  // Lines starting inside the removed bytes, or just after them, are gone
+  auto from = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+  auto to = std::upper_bound(from, lineStarts.end(), offset + removed);
+  for (auto at = to; at != lineStarts.end(); ++at) {
+    *at = static_cast<uint32_t>(*at + delta);
+  }
+  std::vector<uint32_t> added;
+  for (size_t at = text.find('\n'); at != std::string_view::npos;
+       at = text.find('\n', at + 1)) {
+    added.push_back(static_cast<uint32_t>(offset + at + 1));
+  }
+  lineStarts.insert(lineStarts.erase(from, to), added.begin(), added.end());
+  // Long tokens inside the edit are lexed again
+  if (longTokens.empty()) return;
+  std::unordered_map<uint32_t, uint32_t> moved;
+  for (auto [start, length] : longTokens) {
+    if (start < offset) {
+      moved.emplace(start, length);
+    } else if (start >= offset + removed) {
+      moved.emplace(static_cast<uint32_t>(start + delta), length);
+    }
+  }
+  longTokens = std::move(moved);
+}
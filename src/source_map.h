@@ -0,0 +1,46 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_SOURCE_MAP_H_
+#define INCLUDE_SRC_SOURCE_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+#include "token.h"
+// Source map - turns token offsets back into text and line/column. Line starts
+// are found once per file; a line and column are only worked out when a
+// diagnostic or the AST asks for one
+class SourceMap {
+ public:
+  explicit SourceMap(std::string_view input);
+  // Return the text of a token
+  std::string_view text(const Token& token) const;
+  // Return the line and column (both from 1) of a byte offset
+  SourceLocation locate(uint32_t offset) const;
+  // As above, trying the line of the previous call first - callers moving
+  // forwards through the file keep one hint and avoid the binary search
+  SourceLocation locate(uint32_t offset, size_t& lineHint) const;
+  // Record the length of a token too long for Token::length. Lexers on several
+  // threads may record at once, but not while tokens are being looked up
+  void addLongToken(uint32_t offset, size_t length);
+  // Replace removed bytes at offset with text. The map then holds its own copy
+  // of the input; token lengths and line starts past the edit are moved along
+  void edit(size_t offset, size_t removed, std::string_view text);
+  std::string_view source() const { return input; }
+
+ private:
+  std::string_view input;  // Non-owning reference to data, unless edited
+  std::string edited;
+  // Offset of the first character of every line
+  std::vector<uint32_t> lineStarts;
+  // Lengths of tokens marked Token::kLongToken, by offset
+  std::unordered_map<uint32_t, uint32_t> longTokens;
+  std::mutex longTokensLock;
+};
+
+#endif  // INCLUDE_SRC_SOURCE_MAP_H_
@@ -12,94 +12,53 @@ Stmt::Stmt(Stmt&& stmt) noexcept
       stmt(std::move(stmt.stmt)) {}
 Stmt::~Stmt() = default;
 ClassStmt::ClassStmt(const ClassStmt& class_stmt)
-    : name(class_stmt.name), structType(class_stmt.structType) {
-  // Add parameters
-  for (auto& stmt : class_stmt.parameters) {
-    this->parameters.emplace_back(stmt);
-  }
-}
+    : name(class_stmt.name),
+      parameters(class_stmt.parameters),
+      structType(class_stmt.structType) {}
 ClassStmt::ClassStmt(ClassStmt&& class_stmt) noexcept
-    : name(std::move(class_stmt.name)), structType(class_stmt.structType) {
-  // Add parameters
-  for (auto stmt : class_stmt.parameters) {
-    this->parameters.emplace_back(std::move(stmt));
-  }
-}
-
+    : name(class_stmt.name),
+      parameters(std::move(class_stmt.parameters)),
+      structType(std::move(class_stmt.structType)) {}
 ClassStmt::~ClassStmt() = default;
 ImplStmt::ImplStmt(const ImplStmt& impl_stmt)
     : name(impl_stmt.name),
       decorating(impl_stmt.decorating),
-      implType(impl_stmt.implType) {
-  // Add parameters
-  for (auto& stmt : impl_stmt.parameters) {
-    this->parameters.emplace_back(stmt);
-  }
-}
+      decorated(impl_stmt.decorated),
+      parameters(impl_stmt.parameters),
+      implType(impl_stmt.implType) {}
 ImplStmt::ImplStmt(ImplStmt&& impl_stmt) noexcept
-    : name(std::move(impl_stmt.name)),
-      decorating(std::move(impl_stmt.decorating)),
-      implType(std::move(impl_stmt.implType)) {
-  // Add parameters
-  for (auto stmt : impl_stmt.parameters) {
-    this->parameters.emplace_back(std::move(stmt));
-  }
-}
+    : name(impl_stmt.name),
+      decorating(impl_stmt.decorating),
+      decorated(impl_stmt.decorated),
+      parameters(std::move(impl_stmt.parameters)),
+      implType(std::move(impl_stmt.implType)) {}
 ImplStmt::~ImplStmt() = default;
-DeclarationStmt::DeclarationStmt(const DeclarationStmt& declaration_stmt)
-    : consted(declaration_stmt.consted),
-      name(declaration_stmt.name),
-      val(declaration_stmt.val ? declaration_stmt.val->clone() : nullptr) {}
-DeclarationStmt::DeclarationStmt(DeclarationStmt&& declaration_stmt) noexcept
-    : consted(declaration_stmt.consted),
-      name(std::move(declaration_stmt.name)),
-      val(std::move(declaration_stmt.val)) {}
-// Copy another declaration statement
-DeclarationStmt& DeclarationStmt::operator=(DeclarationStmt&& other) noexcept {
-  consted = other.consted;
-  name = other.name;
-  val = std::move(other.val);
-  return *this;
-}
-DeclarationStmt& DeclarationStmt::operator=(const DeclarationStmt& other) {
-  consted = other.consted;
-  name = other.name;
-  val = other.val->clone();
-  return *this;
-}
-DeclarationStmt::~DeclarationStmt() = default;
+// Assignment replaces the parameters
 ClassStmt& ClassStmt::operator=(const ClassStmt& other) {
   name = other.name;
-  for (auto& param : other.parameters) {
-    parameters.emplace_back(param);
-  }
+  parameters = other.parameters;
   structType = other.structType;
   return *this;
 }
 ClassStmt& ClassStmt::operator=(ClassStmt&& other) noexcept {
-  name = std::move(other.name);
-  for (auto& param : other.parameters) {
-    parameters.emplace_back(std::move(param));
-  }
+  name = other.name;
+  parameters = std::move(other.parameters);
   structType = std::move(other.structType);
   return *this;
 }
-
 ImplStmt& ImplStmt::operator=(const ImplStmt& other) {
   name = other.name;
   decorating = other.decorating;
-  for (auto& param : other.parameters) {
-    parameters.emplace_back(param);
-  }
+  decorated = other.decorated;
+  parameters = other.parameters;
   implType = other.implType;
   return *this;
 }
 ImplStmt& ImplStmt::operator=(ImplStmt&& other) noexcept {
-  name = std::move(other.name);
-  decorating = std::move(other.decorating);
-  for (auto& param : other.parameters) {
-    parameters.emplace_back(std::move(param));
-  }
+  name = other.name;
+  decorating = other.decorating;
+  decorated = other.decorated;
+  parameters = std::move(other.parameters);
   implType = std::move(other.implType);
   return *this;
 }
@@ -116,23 +75,3 @@ Stmt& Stmt::operator=(Stmt&& other) noexcept {
   stmt = std::move(other.stmt);
   return *this;
 }
-
-ReturnStmt::ReturnStmt(const ReturnStmt& return_stmt)
-    : val(return_stmt.val ? return_stmt.val->clone() : nullptr) {}
-ReturnStmt& ReturnStmt::operator=(const ReturnStmt& other) {
-  val = other.val ? other.val->clone() : nullptr;
-  return *this;
-}
-
-YieldStmt::YieldStmt(const YieldStmt& yield_stmt)
-    : val(yield_stmt.val ? yield_stmt.val->clone() : nullptr) {}
-YieldStmt& YieldStmt::operator=(const YieldStmt& other) {
-  val = other.val ? other.val->clone() : nullptr;
-  return *this;
-}
-ExprStmt::ExprStmt(const ExprStmt& expr_stmt)
-    : val(expr_stmt.val ? expr_stmt.val->clone() : nullptr) {}
-ExprStmt& ExprStmt::operator=(const ExprStmt& other) {
-  val = other.val ? other.val->clone() : nullptr;
-  return *this;
-}
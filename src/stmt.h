@@ -4,65 +4,47 @@
 #define SENIORPROJECT_STMT_H
 #include <memory>
 #include <source_location>
+#include <string>
 #include <type_traits>
 #include <vector>
 
 #include "common.h"
 #include "expr.h"
+#include "symbol.h"
 #include "types.h"
-template <typename T>
+template <typename Derived, typename T>
 struct StmtVisitor;
 struct Stmt;
 // Declaration statement - whether const is used, name of the variable, value
 struct DeclarationStmt {
   bool consted;
-  std::string name;
-  std::unique_ptr<Expr> val;
+  Symbol name;
+  Expr* val = nullptr;
+  // Slot of the declaration in its function's locals, or in the program's
+  // members for a global; set by the resolver
+  uint32_t slot = DeclarationRef::kUnresolved;
+  // Declaration of each let and loop variable in val outside any function,
+  // by slot, for a global, field or method; set by the resolver
+  std::vector<Stmt*> locals;
   DeclarationStmt() = default;
-  DeclarationStmt(bool consted, std::string name, std::unique_ptr<Expr> val)
-      : consted(consted), name(std::move(name)), val(std::move(val)){};
-  DeclarationStmt(const DeclarationStmt& declaration_stmt);
-  DeclarationStmt(DeclarationStmt&& declaration_stmt) noexcept;
-  DeclarationStmt& operator=(DeclarationStmt&& other) noexcept;
-  DeclarationStmt& operator=(const DeclarationStmt& other);
-  ~DeclarationStmt();
+  DeclarationStmt(bool consted, Symbol name, Expr* val)
+      : consted(consted), name(name), val(val){};
 };
 // Return statement - value
 struct ReturnStmt {
-  std::unique_ptr<Expr> val;
-  ReturnStmt() = default;
-  ReturnStmt(std::unique_ptr<Expr> val) : val(std::move(val)){};
-  ReturnStmt(const ReturnStmt& return_stmt);
-  ReturnStmt(ReturnStmt&& return_stmt) noexcept = default;
-  ReturnStmt& operator=(ReturnStmt&& other) noexcept = default;
-  ReturnStmt& operator=(const ReturnStmt& other);
-  ~ReturnStmt() = default;
+  Expr* val = nullptr;
 };
 // Yield statement - value
 struct YieldStmt {
-  std::unique_ptr<Expr> val;
-  YieldStmt() = default;
-  YieldStmt(std::unique_ptr<Expr> val) : val(std::move(val)){};
-  YieldStmt(const YieldStmt& yield_stmt);
-  YieldStmt(YieldStmt&& yield_stmt) noexcept = default;
-  YieldStmt& operator=(YieldStmt&& other) noexcept = default;
-  YieldStmt& operator=(const YieldStmt& other);
-  ~YieldStmt() = default;
+  Expr* val = nullptr;
 };
 // Expression statement - value
 struct ExprStmt {
-  std::unique_ptr<Expr> val;
-  ExprStmt() = default;
-  ExprStmt(std::unique_ptr<Expr> val) : val(std::move(val)){};
-  ExprStmt(const ExprStmt& yield_stmt);
-  ExprStmt(ExprStmt&& yield_stmt) noexcept = default;
-  ExprStmt& operator=(ExprStmt&& other) noexcept = default;
-  ExprStmt& operator=(const ExprStmt& other);
-  ~ExprStmt() = default;
+  Expr* val = nullptr;
 };
 // Class statement - name, parameters, type
 struct ClassStmt {
-  std::string name;
+  Symbol name;
   std::vector<Stmt> parameters;
   std::shared_ptr<Type> structType;
   ClassStmt() = default;
@@ -74,8 +56,10 @@ struct ClassStmt {
 };
 // Impl statement - name, whether decorating, parameters, and type
 struct ImplStmt {
-  std::string name;
-  std::string decorating;
+  Symbol name;
+  Symbol decorating;
+  // Name a decorating impl is declared under - "$name$decorating"
+  Symbol decorated;
   std::vector<Stmt> parameters;
   std::shared_ptr<Type> implType;
   ImplStmt() = default;
@@ -101,10 +85,6 @@ struct Stmt {
   SourceLocation location;
   std::shared_ptr<Type> type;
   InnerStmt stmt;
-  // Clone a pointer to this statement
-  [[nodiscard]] std::unique_ptr<Stmt> clone() const {
-    return std::make_unique<Stmt>(*this);
-  }
   // Constructors and destructor
   Stmt() = default;
   Stmt(SourceLocation location, std::shared_ptr<Type> type, InnerStmt stmt)
@@ -116,61 +96,29 @@ struct Stmt {
   ~Stmt();
   // Check if statement is of various types
   bool isDeclarationStmt() {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, DeclarationStmt>;
-        },
-        stmt);
+    return std::holds_alternative<DeclarationStmt>(stmt);
   }
   bool isReturnStmt() {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, ReturnStmt>;
-        },
-        stmt);
+    return std::holds_alternative<ReturnStmt>(stmt);
   }
   bool isYieldStmt() {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, YieldStmt>;
-        },
-        stmt);
+    return std::holds_alternative<YieldStmt>(stmt);
   }
   bool isExprStmt() {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, ExprStmt>;
-        },
-        stmt);
+    return std::holds_alternative<ExprStmt>(stmt);
   }
   bool isClassStmt() {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, ClassStmt>;
-        },
-        stmt);
+    return std::holds_alternative<ClassStmt>(stmt);
   }
   bool isImplStmt() {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, ImplStmt>;
-        },
-        stmt);
+    return std::holds_alternative<ImplStmt>(stmt);
   }
 
   bool isTypeDef() {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, TypeDef>;
-        },
-        stmt);
+    return std::holds_alternative<TypeDef>(stmt);
   }
   bool isContinueStmt() {
-    return std::visit(
-        [](auto&& arg) {
-          return std::is_same_v<std::decay_t<decltype(arg)>, ContinueStmt>;
-        },
-        stmt);
+    return std::holds_alternative<ContinueStmt>(stmt);
   }
   // Return a statement of various types
   DeclarationStmt* getDeclarationStmt() {
@@ -183,76 +131,67 @@ struct Stmt {
   ImplStmt* getImplStmt() { return &std::get<ImplStmt>(stmt); }
   TypeDef* getTypeDef() { return &std::get<TypeDef>(stmt); }
   ContinueStmt* getContinueStmt() { return &std::get<ContinueStmt>(stmt); }
-  // Get string name, based on type, and "" if none
-  [[nodiscard]] std::string getName() const {
+  // Get name, based on type, and "" if none
+  [[nodiscard]] Symbol getName() const {
     return std::visit(
-[](auto&& arg) -> std::string {
+[](auto&& arg) -> Symbol {
 using T = std::decay_t< decltype(arg)>;
           if constexpr (std::is_same_v<T, DeclarationStmt>) {return arg.name;
           } else if constexpr (std::is_same_v<T, ClassStmt>) {return arg.name;
           } else if constexpr (std::is_same_v<T, ImplStmt>) {
-            if(arg.decorating.empty()) {
-              return arg.name;
-            } else {
-              return "$" + arg.name + "$" + arg.decorating;
-            }
+            return arg.decorating.empty() ? arg.name : arg.decorated;
           } else if constexpr (std::is_same_v<T, TypeDef>) {return arg.type->getAliasType()->alias;
-          } else {return "Again";}},
+          } else {return Symbol{"Again"};}},
         stmt);
   };
-  template <typename R>
-  // Visit the statement based on its inner type
-  R accept(StmtVisitor<R>* visitor) {
-    return std::visit(
-        [visitor, this](auto&& arg) -> R {
-          using T = std::decay_t<decltype(arg)>;
-          if (std::is_same_v<T, ContinueStmt>) {
-            return visitor->visitContinueStmt(this);
-          } else if (std::is_same_v<T, DeclarationStmt>) {
-            return visitor->visitDeclarationStmt(this);
-          } else if (std::is_same_v<T, ReturnStmt>) {
-            return visitor->visitReturnStmt(this);
-          } else if (std::is_same_v<T, YieldStmt>) {
-            return visitor->visitYieldStmt(this);
-          } else if (std::is_same_v<T, ExprStmt>) {
-            return visitor->visitExprStmt(this);
-          } else if (std::is_same_v<T, ClassStmt>) {
-            return visitor->visitClassStmt(this);
-          } else if (std::is_same_v<T, ImplStmt>) {
-            return visitor->visitImplStmt(this);
-          } else if (std::is_same_v<T, TypeDef>) {
-            return visitor->visitTypeDef(this);
-          }
-        },
-        stmt);
+  // Index of an alternative of the inner statement
+  template <typename T>
+  static constexpr size_t kIndex = AlternativeIndex<T, InnerStmt>::value;
+  template <typename R, typename Visitor>
+  // Visit the statement based on its inner type - a switch on the index, so
+  // the visitor's function is called directly
+  R accept(Visitor* visitor) {
+    static_assert(std::variant_size_v<InnerStmt> == 8,
+                  "Every kind of statement needs a case");
+    switch (stmt.index()) {
+      case kIndex<ContinueStmt>:
+        return visitor->visitContinueStmt(this);
+      case kIndex<DeclarationStmt>:
+        return visitor->visitDeclarationStmt(this);
+      case kIndex<ReturnStmt>:
+        return visitor->visitReturnStmt(this);
+      case kIndex<YieldStmt>:
+        return visitor->visitYieldStmt(this);
+      case kIndex<ExprStmt>:
+        return visitor->visitExprStmt(this);
+      case kIndex<ClassStmt>:
+        return visitor->visitClassStmt(this);
+      case kIndex<ImplStmt>:
+        return visitor->visitImplStmt(this);
+      default:
+        return visitor->visitTypeDef(this);
+    }
   }
 };
-template <typename T>
-// Visitor for a statement
+template <typename Derived, typename T>
+// Visitor for a statement - Derived supplies enterStmtVisitor,
+// exitStmtVisitor and a visit function for every kind of statement
 struct StmtVisitor {
   // Visit a statement - return ans from accepting, if type is not void
   T visitStmt(Stmt* stmt) {
-    enterStmtVisitor();
+    derived()->enterStmtVisitor();
     if constexpr (std::is_same_v<T, void>) {
-      stmt->accept(this);
-      exitStmtVisitor();
+      stmt->accept<T>(derived());
+      derived()->exitStmtVisitor();
     } else {
-      T ans = stmt->accept(this);
-      exitStmtVisitor();
+      T ans = stmt->accept<T>(derived());
+      derived()->exitStmtVisitor();
       return ans;
     }
   }
-  T _visitStmt(Stmt* stmt) { return stmt->accept(this); }
-  // Pure virtual functions
-  virtual void enterStmtVisitor() = 0;
-  virtual void exitStmtVisitor() = 0;
-  virtual T visitContinueStmt(Stmt* continueStmt) = 0;
-  virtual T visitDeclarationStmt(Stmt* declarationStmt) = 0;
-  virtual T visitReturnStmt(Stmt* returnStmt) = 0;
-  virtual T visitYieldStmt(Stmt* yieldStmt) = 0;
-  virtual T visitExprStmt(Stmt* exprStmt) = 0;
-  virtual T visitClassStmt(Stmt* classStmt) = 0;
-  virtual T visitImplStmt(Stmt* implStmt) = 0;
-  virtual T visitTypeDef(Stmt* typeDef) = 0;
+  T _visitStmt(Stmt* stmt) { return stmt->accept<T>(derived()); }
+
+ private:
+  Derived* derived() { return static_cast<Derived*>(this); }
 };
 #endif  // SENIORPROJECT_STMT_H
@@ -0,0 +1,98 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#include "stream_lexer.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <io.h>
+#define read _read
+#else
+#include <unistd.h>
+#endif
+
+// The lexer looks at most this many characters past the end of a token (a
+// digit after "1." decides between INT and FLOAT)
+constexpr size_t kLookahead = 2;
+// Longest character literal, '\xHH'
+constexpr size_t kLongestChar = 6;
+
+StreamLexer::StreamLexer(int fd, size_t chunkSize)
+    : fd(fd),
+      chunkSize(chunkSize ? chunkSize : kDefaultChunkSize),
+      window(std::make_shared<std::string>()) {
+  lexer.emplace(*window);
+}
+// Lex from the window until a token is known to be complete
+StreamToken StreamLexer::next() {
+  for (;;) {
+    Token token = lexer->next();
+    std::string_view text = lexer->sourceMap()->text(token);
+    if (!settled(token, text)) {
+      refill(token.offset);
+      continue;
+    }
+    countLines(token.offset);
+    SourceLocation location{
+        line, static_cast<int>(base + token.offset - lineStart + 1)};
+    // Strings may hold newlines
+    countLines(token.offset + text.size());
+    token.offset = static_cast<uint32_t>(base + token.offset);
+    return StreamToken{token, location, text, window};
+  }
+}
+// Returns true if more input could not change a token
+bool StreamLexer::settled(const Token& token, std::string_view text) const {
+  if (eof) return true;
+  size_t size = window->size();
+  switch (token.type) {
+    case TOKEN_TYPE::FILE_END:
+      return false;
+    case TOKEN_TYPE::ERROR:
+      // Strings and characters may just be cut off by the end of the window
+      if ((*window)[token.offset] == '"') return false;
+      if ((*window)[token.offset] == '\'') {
+        return size - token.offset >= kLongestChar;
+      }
+      return true;
+    default:
+      return token.offset + text.size() + kLookahead <= size;
+  }
+}
+// Start a new window at keepFrom, followed by the next chunk of input
+void StreamLexer::refill(size_t keepFrom) {
+  countLines(keepFrom);
+  auto next = std::make_shared<std::string>(*window, keepFrom);
+  size_t kept = next->size();
+  next->resize(kept + chunkSize);
+  long got;
+  do {
+    got = read(fd, next->data() + kept, static_cast<unsigned>(chunkSize));
+  } while (got < 0 && errno == EINTR);
+  if (got < 0) {
+    std::cerr << "Cannot read input: " << std::strerror(errno) << ".\n";
+    exit(-1);
+  }
+  if (got == 0) eof = true;
+  next->resize(kept + got);
+  base += keepFrom;
+  counted = 0;
+  // Tokens already handed out keep the old window alive
+  window = std::move(next);
+  lexer.emplace(*window);
+}
+// Move the line count up to a window position
+void StreamLexer::countLines(size_t to) {
+  if (to <= counted) return;
+  const char* begin = window->data();
+  for (const char* at = begin + counted; at < begin + to;) {
+    const void* newline = std::memchr(at, '\n', begin + to - at);
+    if (!newline) break;
+    at = static_cast<const char*>(newline) + 1;
+    ++line;
+    lineStart = base + (at - begin);
+  }
+  counted = to;
+}
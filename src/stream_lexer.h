@@ -0,0 +1,59 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_STREAM_LEXER_H_
+#define INCLUDE_SRC_STREAM_LEXER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "common.h"
+#include "lexer.h"
+#include "token.h"
+// Token from a stream - text and location are filled in, and the chunk the
+// text points into is kept alive for as long as the token is
+struct StreamToken {
+  Token token;  // Offset counts from the start of the stream (mod 4 GiB)
+  SourceLocation location;
+  std::string_view text;
+  std::shared_ptr<const std::string> chunk;
+};
+// Stream lexer - tokenize a file descriptor (stdin, a pipe) a chunk at a time.
+// Only the current chunk, and chunks still pinned by tokens the caller holds,
+// stay in memory. A token that might continue past the end of a chunk is
+// lexed again once the next chunk has been read behind it
+class StreamLexer {
+ public:
+  static constexpr size_t kDefaultChunkSize = 64 * 1024;
+  explicit StreamLexer(int fd, size_t chunkSize = kDefaultChunkSize);
+  StreamLexer(const StreamLexer&) = delete;
+  StreamLexer& operator=(const StreamLexer&) = delete;
+  ~StreamLexer() = default;
+
+  // Return the next token
+  StreamToken next();
+
+ private:
+  bool settled(const Token& token, std::string_view text) const;
+  void refill(size_t keepFrom);
+  void countLines(size_t to);
+  // Input and how much of it to read at a time
+  int fd;
+  size_t chunkSize;
+  bool eof = false;
+  // Current chunk, with the unfinished token from the last one in front, and
+  // a lexer over it
+  std::shared_ptr<std::string> window;
+  std::optional<Lexer> lexer;
+  // Stream offset of the start of the window
+  uint64_t base = 0;
+  // Window position newlines have been counted up to, the line there, and the
+  // stream offset that line starts at
+  size_t counted = 0;
+  int line = 1;
+  uint64_t lineStart = 0;
+};
+
+#endif  // INCLUDE_SRC_STREAM_LEXER_H_
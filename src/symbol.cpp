@@ -0,0 +1,62 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#include "symbol.h"
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+// Every name interned so far, by id, and the id of each name. A deque never
+// moves its strings, so the map's keys can point into it
+struct SymbolTable {
+  std::shared_mutex lock;
+  std::deque<std::string> names{std::string{}};
+  std::unordered_map<std::string_view, uint32_t> ids{{names.front(), 0}};
+};
+static SymbolTable& symbolTable() {
+  static SymbolTable table;
+  return table;
+}
+// Return the id and stored copy of a name, adding it if it is new
+static std::pair<uint32_t, std::string_view> internName(std::string_view name) {
+  SymbolTable& table = symbolTable();
+  {
+    std::shared_lock reader(table.lock);
+    auto found = table.ids.find(name);
+    if (found != table.ids.end()) return {found->second, found->first};
+  }
+  std::unique_lock writer(table.lock);
+  auto found = table.ids.find(name);
+  if (found != table.ids.end()) return {found->second, found->first};
+  auto index = static_cast<uint32_t>(table.names.size());
+  std::string_view stored = table.names.emplace_back(name);
+  table.ids.emplace(stored, index);
+  return {index, stored};
+}
+// Names repeat, so each thread remembers recent ones in a small direct-mapped
+// cache and only goes to the shared table on a miss
+constexpr size_t kRecentSymbols = 1024;
+Symbol::Symbol(std::string_view name) {
+  struct Recent {
+    std::string_view name;
+    uint32_t index = 0;
+  };
+  static thread_local Recent recent[kRecentSymbols];
+  Recent& slot =
+      recent[std::hash<std::string_view>{}(name) % kRecentSymbols];
+  if (slot.index != 0 && slot.name == name) {
+    index = slot.index;
+    return;
+  }
+  auto [interned, stored] = internName(name);
+  index = interned;
+  slot = Recent{stored, interned};
+}
+std::string_view Symbol::str() const {
+  SymbolTable& table = symbolTable();
+  std::shared_lock reader(table.lock);
+  return table.names[index];
+}
+std::ostream& operator<<(std::ostream& out, Symbol symbol) {
+  return out << symbol.str();
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_SYMBOL_H_
+#define INCLUDE_SRC_SYMBOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string_view>
+// Symbol - an identifier interned once in a process-wide table. Equal names
+// get equal ids, so comparing and hashing symbols never touches the name.
+// Interning is safe from any thread
+class Symbol {
+ public:
+  // The empty name
+  Symbol() = default;
+  // Intern a name
+  explicit Symbol(std::string_view name);
+  // Return the name, valid for the rest of the process
+  std::string_view str() const;
+  uint32_t id() const { return index; }
+  bool empty() const { return index == 0; }
+  bool operator==(const Symbol& other) const = default;
+
+ private:
+  uint32_t index = 0;
+};
+std::ostream& operator<<(std::ostream& out, Symbol symbol);
+// Ids are dense, so they hash to themselves
+template <>
+struct std::hash<Symbol> {
+  size_t operator()(Symbol symbol) const noexcept { return symbol.id(); }
+};
+
+#endif  // INCLUDE_SRC_SYMBOL_H_
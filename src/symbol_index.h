@@ -0,0 +1,93 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_SYMBOL_INDEX_H_
+#define INCLUDE_SRC_SYMBOL_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "symbol.h"
+// Symbol index - open-addressing hash from names to slots of an array its
+// owner keeps. Only slots are stored: the name at a slot is asked of the
+// owner (nameOf), so names are never copied, and a probe compares ids
+class SymbolIndex {
+ public:
+  static constexpr uint32_t kNone = UINT32_MAX;
+  explicit SymbolIndex(
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : cells(resource) {}
+  // Return the number of names held
+  size_t size() const { return used; }
+  // Return the slot under name, kNone if there is none
+  template <typename NameOf>
+  uint32_t find(Symbol name, const NameOf& nameOf) const {
+    if (cells.empty()) return kNone;
+    for (size_t at = home(name);; at = next(at)) {
+      uint32_t slot = cells[at];
+      if (slot == kNone || nameOf(slot) == name) return slot;
+    }
+  }
+  // Put slot under name, in place of the slot already there if any
+  template <typename NameOf>
+  void set(Symbol name, uint32_t slot, const NameOf& nameOf) {
+    if ((used + 1) * 2 > cells.size()) grow(nameOf);
+    size_t at = home(name);
+    while (cells[at] != kNone && !(nameOf(cells[at]) == name)) at = next(at);
+    if (cells[at] == kNone) ++used;
+    cells[at] = slot;
+  }
+  // Take name out, if it is held
+  template <typename NameOf>
+  void erase(Symbol name, const NameOf& nameOf) {
+    if (cells.empty()) return;
+    size_t gap = home(name);
+    for (;; gap = next(gap)) {
+      if (cells[gap] == kNone) return;
+      if (nameOf(cells[gap]) == name) break;
+    }
+    --used;
+    // Move the rest of the run back over the gap, where it may go, so that
+    // no probe stops early
+    for (size_t at = next(gap);; at = next(at)) {
+      uint32_t slot = cells[at];
+      if (slot == kNone) break;
+      size_t want = home(nameOf(slot));
+      if (((at - want) & mask()) >= ((at - gap) & mask())) {
+        cells[gap] = slot;
+        gap = at;
+      }
+    }
+    cells[gap] = kNone;
+  }
+
+ private:
+  static constexpr size_t kMinCells = 16;
+  size_t mask() const { return cells.size() - 1; }
+  size_t next(size_t at) const { return (at + 1) & mask(); }
+  // Ids are dense, so they are spread by a multiplicative hash
+  size_t home(Symbol name) const {
+    return static_cast<size_t>(
+        (static_cast<uint64_t>(name.id()) * 0x9E3779B97F4A7C15ull) >> shift);
+  }
+  // Double the cells, and put every slot back
+  template <typename NameOf>
+  void grow(const NameOf& nameOf) {
+    std::pmr::vector<uint32_t> old(cells.size() ? cells.size() * 2 : kMinCells,
+                                   kNone, cells.get_allocator());
+    old.swap(cells);
+    shift = 64;
+    for (size_t size = cells.size(); size > 1; size /= 2) --shift;
+    for (uint32_t slot : old) {
+      if (slot == kNone) continue;
+      size_t at = home(nameOf(slot));
+      while (cells[at] != kNone) at = next(at);
+      cells[at] = slot;
+    }
+  }
+  std::pmr::vector<uint32_t> cells;
+  size_t used = 0;
+  int shift = 64;
+};
+
+#endif  // INCLUDE_SRC_SYMBOL_INDEX_H_
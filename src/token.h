@@ -1,12 +1,13 @@
 // Copyright (c) 2024 Compile Collective. All Rights Reserved.
 #ifndef SENIORPROJECT_TOKEN_H_
 #define SENIORPROJECT_TOKEN_H_
+#include <cstdint>
 #include <string>
 #include <string_view>
 
 #include "common.h"
 // List of token types
-enum class TOKEN_TYPE {
+enum class TOKEN_TYPE : uint16_t {
   INT,
   PLUS,
   MINUS,
@@ -71,10 +72,13 @@ enum class TOKEN_TYPE {
   VOID
 };
 std::string debugTokenTypes(TOKEN_TYPE type);
-// Token information - type, input text, and location
+// Token information - where the text starts in the input, its length, and
+// type. Text and location are looked up through the file's SourceMap
 struct Token {
+  uint32_t offset;
+  uint16_t length;  // kLongToken if the SourceMap holds the length
   TOKEN_TYPE type;
-  std::string_view text;
-  SourceLocation sourceLocation;
+  static constexpr uint16_t kLongToken = UINT16_MAX;
 };
+static_assert(sizeof(Token) == 8, "tokens should pack into 8 bytes");
 #endif  // SENIORPROJECT_TOKEN_H__
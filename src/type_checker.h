@@ -3,123 +3,300 @@
 #ifndef SENIORPROJECT_TYPE_CHECKER_H
 #define SENIORPROJECT_TYPE_CHECKER_H
 #include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "environment.h"
 #include "expr.h"
-#include "parser.h"
 #include "stmt.h"
 #include "token.h"
 #include "types.h"
 
 // Type checker - ensure type compatibility
-struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
-  // Constructor - take in an environment
-  TypeChecker(Environment* program) : program(program){};
-  // Check a declaration statement
-  void visitDeclarationStmt(Stmt* stmt) override {
+struct TypeChecker : public ExprVisitor<TypeChecker, Expr*>,
+                     StmtVisitor<TypeChecker, void> {
+  // Constructor - take in an environment, and where to report diagnostics
+  TypeChecker(Environment* program, std::ostream& errors = std::cerr)
+      : program(program),
+        globals(program),
+        arena(program->arena),
+        errors(&errors){};
+  // Check a declaration statement - the value of a global, field or method
+  // is a frame of its own, for the lets in it
+  void visitDeclarationStmt(Stmt* stmt) {
+    bool outer = frames.empty();
+    if (outer) frames.push_back(&stmt->getDeclarationStmt()->locals);
     if (stmt->getDeclarationStmt()->val) {
-      _visitExpr(stmt->getDeclarationStmt()->val.get());
-      if (stmt->type->isAliasType() && !stmt->type->getAliasType()->type) {
-        stmt->type =
-            program->getMember(stmt->type->getAliasType()->alias)->type;
-      }
+      _visitExpr(stmt->getDeclarationStmt()->val);
       if (!stmt->type) {
         stmt->type = stmt->getDeclarationStmt()->val->type;
       } else {
         // If conversion is explicit or impossible, output error
-        switch (stmt->type->isConvertible(
-            stmt->getDeclarationStmt()->val->type.get())) {
+        switch (program->types->isConvertible(
+            stmt->type.get(), stmt->getDeclarationStmt()->val->type.get())) {
           case Convert::SAME:
             break;
           case Convert::IMPLICIT:
             break;
           case Convert::EXPLICIT:
           case Convert::FALSE:
-            std::cerr << "These don't fit together";
+            *errors << "These don't fit together";
         }
       }
     }
+    if (outer) frames.pop_back();
   }
   // Enter and exit statement visitors (no implementation)
-  void enterStmtVisitor() override {}
-  void exitStmtVisitor() override {}
+  void enterStmtVisitor() {}
+  void exitStmtVisitor() {}
   // Check a continue statement (no implementation)
-  void visitContinueStmt(Stmt* continueStmt) override { return; }
+  void visitContinueStmt(Stmt* continueStmt) { return; }
   // Check a return statement
-  void visitReturnStmt(Stmt* returnStmt) override {
-    _visitExpr(returnStmt->getReturnStmt()->val.get());
+  void visitReturnStmt(Stmt* returnStmt) {
+    _visitExpr(returnStmt->getReturnStmt()->val);
   }
   // Check a yield statement
-  void visitYieldStmt(Stmt* yieldStmt) override {
-    _visitExpr(yieldStmt->getYieldStmt()->val.get());
+  void visitYieldStmt(Stmt* yieldStmt) {
+    _visitExpr(yieldStmt->getYieldStmt()->val);
   }
   // Check an expression statement
-  void visitExprStmt(Stmt* exprStmt) override {
-    _visitExpr(exprStmt->getExprStmt()->val.get());
+  void visitExprStmt(Stmt* exprStmt) {
+    _visitExpr(exprStmt->getExprStmt()->val);
   }
-  // Check a class statement
-  void visitClassStmt(Stmt* classStmt) override {
+  // Check a class statement - a class holding itself by value would have no
+  // size
+  void visitClassStmt(Stmt* classStmt) {
+    Type* structType = classStmt->getClassStmt()->structType.get();
+    if (structType && structType->isStructType() && holdsItself(structType)) {
+      *errors << "Class " << classStmt->getClassStmt()->name.str()
+              << " holds itself by value.\n";
+    }
     // Check all parameters
     for (auto& i : classStmt->getClassStmt()->parameters) {
       _visitStmt(&i);
     }
   }
   // No implementations necessary
-  void visitImplStmt(Stmt* implStmt) override {}
-  void visitTypeDef(Stmt* typeDef) override { return; }
-  Expr* visitIntExpr(Expr* expr) override { return expr; }
-  Expr* visitFloatExpr(Expr* expr) override { return expr; }
-  Expr* visitCharExpr(Expr* expr) override { return expr; }
-  Expr* visitBoolExpr(Expr* expr) override { return expr; }
-  Expr* visitStringExpr(Expr* expr) override { return expr; }
-  Expr* visitVoidExpr(Expr* expr) override {return expr;}
+  void visitImplStmt(Stmt* implStmt) {}
+  void visitTypeDef(Stmt* typeDef) { return; }
+  Expr* visitIntExpr(Expr* expr) { return expr; }
+  Expr* visitFloatExpr(Expr* expr) { return expr; }
+  Expr* visitCharExpr(Expr* expr) { return expr; }
+  Expr* visitBoolExpr(Expr* expr) { return expr; }
+  Expr* visitStringExpr(Expr* expr) { return expr; }
+  Expr* visitVoidExpr(Expr* expr) {return expr;}
   void visit() {
     for(int i = 0; i < program->members.size(); ++i) {
-      _visitStmt(program->getMember(program->order[i]));
+      _visitStmt(program->getInOrder(i));
+    }
+  }
+  // Check the globals as visit() does, on up to threads threads (0 for one
+  // per core), each with a checker of its own. A global is only checked once
+  // every global before it that it names, that names it, or that is itself
+  // has been, so it sees just what it would in visit(); the rest are checked
+  // as soon as a thread is free. Diagnostics are written out in order. Needs
+  // the uses the resolver keeps, and checks on this thread without them
+  void visitParallel(unsigned threads = 0) {
+    auto count = static_cast<uint32_t>(program->members.size());
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(
+        std::min<size_t>(threads, count / kMinParallelGlobals));
+    if (threads <= 1 || program->usesBegin.size() != count + 1) {
+      visit();
+      return;
+    }
+    std::pmr::vector<Stmt>& members = program->members;
+    const std::pmr::vector<uint32_t>& order = program->order;
+    const std::vector<uint32_t>& uses = program->uses;
+    const std::vector<uint32_t>& usesBegin = program->usesBegin;
+    // Positions in order of each global, by slot
+    std::vector<uint32_t> atBegin(count + 1, 0);
+    std::vector<uint32_t> at(count);
+    for (uint32_t p = 0; p < count; ++p) ++atBegin[order[p] + 1];
+    for (uint32_t slot = 0; slot < count; ++slot) {
+      atBegin[slot + 1] += atBegin[slot];
+    }
+    std::vector<uint32_t> next(atBegin.begin(), atBegin.end() - 1);
+    for (uint32_t p = 0; p < count; ++p) at[next[order[p]]++] = p;
+    // Calls edge(from, to) for each position to that waits on position from
+    auto forEachEdge = [&](auto&& edge) {
+      for (uint32_t p = 0; p < count; ++p) {
+        uint32_t slot = order[p];
+        for (uint32_t i = atBegin[slot]; i < atBegin[slot + 1] && at[i] < p;
+             ++i) {
+          edge(at[i], p);
+        }
+        for (uint32_t use = usesBegin[slot]; use < usesBegin[slot + 1];
+             ++use) {
+          for (uint32_t i = atBegin[uses[use]]; i < atBegin[uses[use] + 1];
+               ++i) {
+            if (at[i] < p) {
+              edge(at[i], p);
+            } else {
+              edge(p, at[i]);
+            }
+          }
+        }
+      }
+    };
+    std::vector<uint32_t> edgesBegin(count + 1, 0);
+    std::vector<uint32_t> waiting(count, 0);
+    forEachEdge([&](uint32_t from, uint32_t to) {
+      ++edgesBegin[from + 1];
+      ++waiting[to];
+    });
+    for (uint32_t p = 0; p < count; ++p) edgesBegin[p + 1] += edgesBegin[p];
+    std::vector<uint32_t> edges(edgesBegin[count]);
+    next.assign(edgesBegin.begin(), edgesBegin.end() - 1);
+    forEachEdge(
+        [&](uint32_t from, uint32_t to) { edges[next[from]++] = to; });
+    // Positions free to check, earliest last, and how many are unchecked
+    std::vector<uint32_t> ready;
+    for (uint32_t p = count; p-- > 0;) {
+      if (waiting[p] == 0) ready.push_back(p);
+    }
+    uint32_t left = count;
+    std::mutex mutex;
+    std::condition_variable wake;
+    // Each thread's checker, and what it reported at which position. The
+    // first is this thread's, making conversions in the program's arena
+    struct Worker {
+      explicit Worker(Environment* globals) : checker(globals) {}
+      TypeChecker checker;
+      std::unique_ptr<Arena> arena;
+      std::ostringstream out;
+      std::vector<std::pair<uint32_t, std::string>> diagnostics;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+      workers.push_back(std::make_unique<Worker>(globals));
+      Worker& worker = *workers.back();
+      if (i > 0) {
+        worker.arena = std::make_unique<Arena>();
+        worker.checker.arena = worker.arena.get();
+      }
+      worker.checker.errors = &worker.out;
+    }
+    // Positions are taken a few at a time, earliest first, so that threads
+    // seldom meet at the lock and walk the tree in about the order it was
+    // made in when globals are small
+    auto work = [&](Worker& worker) {
+      std::vector<uint32_t> taken;
+      std::unique_lock<std::mutex> lock(mutex);
+      while (true) {
+        wake.wait(lock, [&] { return !ready.empty() || left == 0; });
+        if (left == 0) return;
+        size_t take = std::clamp<size_t>(ready.size() / threads, 1,
+                                         kParallelBatch);
+        taken.assign(ready.rbegin(), ready.rbegin() + take);
+        ready.resize(ready.size() - take);
+        lock.unlock();
+        for (uint32_t p : taken) {
+          worker.checker._visitStmt(&members[order[p]]);
+          if (!worker.out.view().empty()) {
+            worker.diagnostics.emplace_back(p, worker.out.str());
+            worker.out.str("");
+          }
+        }
+        lock.lock();
+        for (uint32_t p : taken) {
+          for (uint32_t edge = edgesBegin[p]; edge < edgesBegin[p + 1];
+               ++edge) {
+            if (--waiting[edges[edge]] == 0) ready.push_back(edges[edge]);
+          }
+        }
+        left -= static_cast<uint32_t>(taken.size());
+        if (left == 0 || !ready.empty()) wake.notify_all();
+      }
+    };
+    std::vector<std::thread> running;
+    for (unsigned i = 1; i < threads; ++i) {
+      running.emplace_back(work, std::ref(*workers[i]));
+    }
+    work(*workers[0]);
+    for (std::thread& thread : running) thread.join();
+    // Diagnostics in order, and conversions kept as long as the program
+    std::vector<std::pair<uint32_t, std::string>> diagnostics;
+    for (auto& worker : workers) {
+      if (worker->arena) arena->adopt(*worker->arena);
+      std::move(worker->diagnostics.begin(), worker->diagnostics.end(),
+                std::back_inserter(diagnostics));
+    }
+    std::sort(diagnostics.begin(), diagnostics.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (const auto& diagnostic : diagnostics) *errors << diagnostic.second;
+  }
+  // Check binary expression - the chain of left sides is walked with an
+  // explicit stack, so 1 + 1 + ... + 1 takes no stack frame per operator
+  Expr* visitBinaryExpr(Expr* expr) {
+    size_t base = binaries.size();
+    Expr* leftmost = expr;
+    while (leftmost->isBinaryExpr()) {
+      binaries.push_back(leftmost);
+      leftmost = leftmost->getBinaryExpr()->left;
+    }
+    _visitExpr(leftmost);
+    // Innermost first, each right side checked before its operator
+    Expr* checked = nullptr;
+    for (size_t i = binaries.size(); i-- > base;) {
+      _visitExpr(binaries[i]->getBinaryExpr()->right);
+      checked = checkBinary(binaries[i]);
     }
+    binaries.resize(base);
+    return checked;
   }
-  // Check binary expression
-  Expr* visitBinaryExpr(Expr* expr) override {
-    // Check both sides
-    _visitExpr(expr->getBinaryExpr()->left.get());
-    _visitExpr(expr->getBinaryExpr()->right.get());
+  // Check a binary operator whose sides are already checked
+  Expr* checkBinary(Expr* expr) {
     switch (expr->getBinaryExpr()->op) {
       case TOKEN_TYPE::PLUS:
       case TOKEN_TYPE::MINUS:
       case TOKEN_TYPE::SLASH:
       case TOKEN_TYPE::STAR: {
         // +-*/ operations require int or float
-        auto convert = expr->getBinaryExpr()->left->type->isConvertible(
+        auto convert = program->types->isConvertible(
+            expr->getBinaryExpr()->left->type.get(),
             expr->getBinaryExpr()->right->type.get());
         if (convert == Convert::SAME) {
           expr->type = expr->getBinaryExpr()->left->type;
           return expr;
         }
         if (convert == Convert::IMPLICIT) {
-          auto typeConv = std::make_unique<Expr>(
-              Expr(expr->getBinaryExpr()->right->sourceLocation,
-                   expr->getBinaryExpr()->left->type,
-                   TypeConvExpr{true, expr->getBinaryExpr()->right->type,
-                                expr->getBinaryExpr()->left->type}));
+          auto typeConv = arena->make<Expr>(
+              expr->getBinaryExpr()->right->sourceLocation,
+              expr->getBinaryExpr()->left->type,
+              arena->make<TypeConvExpr>(
+                  true, expr->getBinaryExpr()->right->type,
+                  expr->getBinaryExpr()->left->type));
           typeConv->getTypeConvExpr()->expr =
-              std::move(expr->getBinaryExpr()->right);
-          expr->getBinaryExpr()->right = std::move(typeConv);
+              expr->getBinaryExpr()->right;
+          expr->getBinaryExpr()->right = typeConv;
           expr->type = expr->getBinaryExpr()->right->type;
           return expr;
         } else {
-          convert = expr->getBinaryExpr()->right->type->isConvertible(
+          convert = program->types->isConvertible(
+              expr->getBinaryExpr()->right->type.get(),
               expr->getBinaryExpr()->left->type.get());
           if (convert == Convert::IMPLICIT) {
-            auto typeConv = std::make_unique<Expr>(
-                Expr(expr->getBinaryExpr()->left->sourceLocation,
-                     expr->getBinaryExpr()->right->type,
-                     TypeConvExpr{true, expr->getBinaryExpr()->left->type,
-                                  expr->getBinaryExpr()->right->type}));
+            auto typeConv = arena->make<Expr>(
+                expr->getBinaryExpr()->left->sourceLocation,
+                expr->getBinaryExpr()->right->type,
+                arena->make<TypeConvExpr>(
+                    true, expr->getBinaryExpr()->left->type,
+                    expr->getBinaryExpr()->right->type));
             typeConv->getTypeConvExpr()->expr =
-                std::move(expr->getBinaryExpr()->left);
-            expr->getBinaryExpr()->left = std::move(typeConv);
+                expr->getBinaryExpr()->left;
+            expr->getBinaryExpr()->left = typeConv;
             expr->type = expr->getBinaryExpr()->right->type;
             return expr;
           } else {
@@ -145,30 +322,34 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
             expr->getBinaryExpr()->right->type !=
                 program->bottomTypes.floatType)
           return nullptr;
-        auto convert = expr->getBinaryExpr()->left->type->isConvertible(
+        auto convert = program->types->isConvertible(
+            expr->getBinaryExpr()->left->type.get(),
             expr->getBinaryExpr()->right->type.get());
         if (convert == Convert::SAME) break;
         if (convert == Convert::IMPLICIT) {
-          auto typeConv = std::make_unique<Expr>(
-              Expr(expr->getBinaryExpr()->right->sourceLocation,
-                   expr->getBinaryExpr()->left->type,
-                   TypeConvExpr{true, expr->getBinaryExpr()->right->type,
-                                expr->getBinaryExpr()->left->type}));
+          auto typeConv = arena->make<Expr>(
+              expr->getBinaryExpr()->right->sourceLocation,
+              expr->getBinaryExpr()->left->type,
+              arena->make<TypeConvExpr>(
+                  true, expr->getBinaryExpr()->right->type,
+                  expr->getBinaryExpr()->left->type));
           typeConv->getTypeConvExpr()->expr =
-              std::move(expr->getBinaryExpr()->right);
-          expr->getBinaryExpr()->right = std::move(typeConv);
+              expr->getBinaryExpr()->right;
+          expr->getBinaryExpr()->right = typeConv;
         } else {
-          convert = expr->getBinaryExpr()->right->type->isConvertible(
+          convert = program->types->isConvertible(
+              expr->getBinaryExpr()->right->type.get(),
               expr->getBinaryExpr()->left->type.get());
           if (convert == Convert::IMPLICIT) {
-            auto typeConv = std::make_unique<Expr>(
-                Expr(expr->getBinaryExpr()->left->sourceLocation,
-                     expr->getBinaryExpr()->right->type,
-                     TypeConvExpr{true, expr->getBinaryExpr()->left->type,
-                                  expr->getBinaryExpr()->right->type}));
+            auto typeConv = arena->make<Expr>(
+                expr->getBinaryExpr()->left->sourceLocation,
+                expr->getBinaryExpr()->right->type,
+                arena->make<TypeConvExpr>(
+                    true, expr->getBinaryExpr()->left->type,
+                    expr->getBinaryExpr()->right->type));
             typeConv->getTypeConvExpr()->expr =
-                std::move(expr->getBinaryExpr()->left);
-            expr->getBinaryExpr()->left = std::move(typeConv);
+                expr->getBinaryExpr()->left;
+            expr->getBinaryExpr()->left = typeConv;
           } else {
             return nullptr;
           }
@@ -191,18 +372,20 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
         expr->type = program->bottomTypes.intType;
         break;
       case TOKEN_TYPE::ASSIGN: {
-        auto convert = expr->getBinaryExpr()->right->type->isConvertible(
+        auto convert = program->types->isConvertible(
+            expr->getBinaryExpr()->right->type.get(),
             expr->getBinaryExpr()->left->type.get());
         if (convert == Convert::FALSE || convert == Convert::EXPLICIT) break;
         if (convert == Convert::SAME) break;
-        auto typeConv = std::make_unique<Expr>(
-            Expr::makeTypeConv(expr->getBinaryExpr()->right->sourceLocation,
+        auto typeConv = arena->make<Expr>(
+            Expr::makeTypeConv(arena,
+                               expr->getBinaryExpr()->right->sourceLocation,
                                expr->getBinaryExpr()->right->type,
                                expr->getBinaryExpr()->left->type));
         typeConv->getTypeConvExpr()->implicit = true;
         typeConv->getTypeConvExpr()->expr =
-            std::move(expr->getBinaryExpr()->right);
-        expr->getBinaryExpr()->right = std::move(typeConv);
+            expr->getBinaryExpr()->right;
+        expr->getBinaryExpr()->right = typeConv;
         break;
       }
       case TOKEN_TYPE::OR:
@@ -218,8 +401,8 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
     return expr;
   }
   // Check prefix expression
-  Expr* visitPrefixExpr(Expr* expr2) override {
-    _visitExpr(expr2->getPrefixExpr()->expr.get());
+  Expr* visitPrefixExpr(Expr* expr2) {
+    _visitExpr(expr2->getPrefixExpr()->expr);
     switch (expr2->getPrefixExpr()->op) {
       case TOKEN_TYPE::MINUS:
         // - requires int or float
@@ -263,67 +446,73 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
     return expr2;
   }
   // Check type conversion expression (no implementation)
-  Expr* visitTypeConvExpr(Expr* expr) override { return expr; }
+  Expr* visitTypeConvExpr(Expr* expr) { return expr; }
   // Check literal expression
-  Expr* visitLiteralExpr(Expr* literalExpr) override {
-    literalExpr->type =
-        program->getMember(literalExpr->getLiteralExpr()->name)
-            ? program->getMember(literalExpr->getLiteralExpr()->name)->type
-            : program->bottomTypes.intType;
+  Expr* visitLiteralExpr(Expr* literalExpr) {
+    Stmt* member = declarationOf(literalExpr->getLiteralExpr()->declaration);
+    literalExpr->type = member ? member->type : program->bottomTypes.intType;
     return literalExpr;
   }
   // Enter and exit visitor (no implementation)
-  void enterExprVisitor() override {}
-  void exitExprVisitor() override {}
+  void enterExprVisitor() {}
+  void exitExprVisitor() {}
   // Visit function and match expression (no implementation)
-  Expr* visitFunctionExpr(Expr* functionExpr) override {
-    _visitExpr(functionExpr->getFunctionExpr()->action.get());
+  Expr* visitFunctionExpr(Expr* functionExpr) {
+    frames.push_back(&functionExpr->getFunctionExpr()->locals);
+    _visitExpr(functionExpr->getFunctionExpr()->action);
+    frames.pop_back();
     return functionExpr;
   }
-  Expr* visitMatchExpr(Expr* matchExpr) override {
-   _visitExpr(matchExpr->getMatchExpr()->cond.get());
+  Expr* visitMatchExpr(Expr* matchExpr) {
+   _visitExpr(matchExpr->getMatchExpr()->cond);
     std::shared_ptr<Type> returner{};
     if (matchExpr->getMatchExpr()->cond->type->isSumType()) {
       for (auto& caser : matchExpr->getMatchExpr()->cases) {
-        auto parsedExpr = Parser(Lexer{std::get<std::string>(caser.cond)},
-                                 program->generateInnerEnvironment().release())
-                              .parse(Parser::parser::TYPE);
-        caser.cond =
-            parsedExpr->getMember("$TypeCheckerType")->getTypeDef()->type;
-        _visitExpr(caser.body.get());
-        returner = Type::mergeTypes(returner, caser.body->type);
+        // Names were parsed as expressions
+        if (caser.isExprCond()) {
+          if (!caser.getExpr()->isLiteralExpr()) {
+            *errors << "Cases of a sum type must be types.\n";
+            return nullptr;
+          }
+          std::shared_ptr<Type> type =
+              typeNamed(caser.getExpr()->getLiteralExpr()->name);
+          if (!type) return nullptr;
+          caser.cond = type;
+        }
+        _visitExpr(caser.body);
+        returner = program->types->merge(returner, caser.body->type);
       }
     } else {
       for (auto& caser : matchExpr->getMatchExpr()->cases) {
-        auto parsedExpr = Parser(Lexer{std::get<std::string>(caser.cond)},
-                                 program->generateInnerEnvironment().release())
-                              .parse(Parser::parser::EXPR);
-        caser.cond = std::move(
-            parsedExpr->getMember("$TypeCheckerExpr")->getExprStmt()->val);
-        std::get<std::unique_ptr<Expr>>(caser.cond).reset(_visitExpr(std::get<std::unique_ptr<Expr>>(caser.cond).release()));
-        caser.body.reset(_visitExpr(caser.body.release()));
-        returner = Type::mergeTypes(returner, caser.body->type);
+        if (!caser.isExprCond()) {
+          *errors << "Cases must be expressions.\n";
+          return nullptr;
+        }
+        std::get<Expr*>(caser.cond) = _visitExpr(caser.getExpr());
+        caser.body = _visitExpr(caser.body);
+        returner = program->types->merge(returner, caser.body->type);
       }
     }
     matchExpr->type = returner;
     return matchExpr;
   }
   // Visit if expression
-  Expr* visitIfExpr(Expr* ifExpr) override {
-   _visitExpr(ifExpr->getIfExpr()->cond.get());
+  Expr* visitIfExpr(Expr* ifExpr) {
+   _visitExpr(ifExpr->getIfExpr()->cond);
     // Condition must be bool
     if (ifExpr->getIfExpr()->cond->type != program->bottomTypes.boolType) {
-      std::cerr << "Big Problem!\n";
+      *errors << "Big Problem!\n";
       return nullptr;
     }
-    ifExpr->getIfExpr()->thenExpr.reset(visitExpr(ifExpr->getIfExpr()->thenExpr.release()));
+    ifExpr->getIfExpr()->thenExpr = visitExpr(ifExpr->getIfExpr()->thenExpr);
     if (!ifExpr->getIfExpr()->elseExpr) {
       ifExpr->type = ifExpr->getIfExpr()->thenExpr->type;
       return ifExpr;
     }
-    ifExpr->getIfExpr()->elseExpr.reset(visitExpr(ifExpr->getIfExpr()->elseExpr.release()));
-    if (ifExpr->getIfExpr()->thenExpr->type->isConvertible(
-            ifExpr->getIfExpr()->elseExpr->type.get()) == Convert::SAME) {
+    ifExpr->getIfExpr()->elseExpr = visitExpr(ifExpr->getIfExpr()->elseExpr);
+    if (program->types->isConvertible(
+        ifExpr->getIfExpr()->thenExpr->type.get(),
+        ifExpr->getIfExpr()->elseExpr->type.get()) == Convert::SAME) {
       ifExpr->type = ifExpr->getIfExpr()->thenExpr->type;
       return ifExpr;
     } else if (ifExpr->getIfExpr()->thenExpr->type ==
@@ -332,16 +521,15 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
         ifExpr->type = ifExpr->getIfExpr()->elseExpr->type;
         return ifExpr;
       } else {
-        ifExpr->type = std::make_shared<Type>(
-            OptionalType(ifExpr->getIfExpr()->elseExpr->type),
-            std::vector<std::shared_ptr<Impl>>{});
-        auto typeConv = std::make_unique<Expr>(
+        ifExpr->type =
+            program->types->optional(ifExpr->getIfExpr()->elseExpr->type);
+        auto typeConv = arena->make<Expr>(
             ifExpr->getIfExpr()->elseExpr->sourceLocation, ifExpr->type,
-            TypeConvExpr{true, ifExpr->getIfExpr()->elseExpr->type,
-                         ifExpr->type});
+            arena->make<TypeConvExpr>(
+                true, ifExpr->getIfExpr()->elseExpr->type, ifExpr->type));
         typeConv->getTypeConvExpr()->expr =
-            std::move(ifExpr->getIfExpr()->elseExpr);
-        ifExpr->getIfExpr()->elseExpr = std::move(typeConv);
+            ifExpr->getIfExpr()->elseExpr;
+        ifExpr->getIfExpr()->elseExpr = typeConv;
         return ifExpr;
       }
     } else if (ifExpr->getIfExpr()->elseExpr->type ==
@@ -350,34 +538,35 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
         ifExpr->type = ifExpr->getIfExpr()->thenExpr->type;
         return ifExpr;
       } else {
-        ifExpr->type = std::make_shared<Type>(
-            OptionalType(ifExpr->getIfExpr()->thenExpr->type),
-            std::vector<std::shared_ptr<Impl>>{});
-        auto typeConv = std::make_unique<Expr>(
+        ifExpr->type =
+            program->types->optional(ifExpr->getIfExpr()->thenExpr->type);
+        auto typeConv = arena->make<Expr>(
             ifExpr->getIfExpr()->thenExpr->sourceLocation, ifExpr->type,
-            TypeConvExpr{true, ifExpr->getIfExpr()->thenExpr->type,
-                         ifExpr->type});
+            arena->make<TypeConvExpr>(
+                true, ifExpr->getIfExpr()->thenExpr->type, ifExpr->type));
         typeConv->getTypeConvExpr()->expr =
-            std::move(ifExpr->getIfExpr()->thenExpr);
-        ifExpr->getIfExpr()->thenExpr = std::move(typeConv);
+            ifExpr->getIfExpr()->thenExpr;
+        ifExpr->getIfExpr()->thenExpr = typeConv;
         return ifExpr;
       }
-    } else if (ifExpr->getIfExpr()->thenExpr->type->isConvertible(
-                   ifExpr->getIfExpr()->elseExpr->type.get()) ==
+    } else if (program->types->isConvertible(
+        ifExpr->getIfExpr()->thenExpr->type.get(),
+        ifExpr->getIfExpr()->elseExpr->type.get()) ==
                Convert::IMPLICIT) {
-    } else if (ifExpr->getIfExpr()->elseExpr->type->isConvertible(
-                   ifExpr->getIfExpr()->thenExpr->type.get()) ==
+    } else if (program->types->isConvertible(
+        ifExpr->getIfExpr()->elseExpr->type.get(),
+        ifExpr->getIfExpr()->thenExpr->type.get()) ==
                Convert::IMPLICIT) {
     } else {
     }
     return ifExpr;
   }
   // Check block expression
-  Expr* visitBlockExpr(Expr* blockExpr) override {
+  Expr* visitBlockExpr(Expr* blockExpr) {
     auto prev = program;
-    program = blockExpr->getBlockExpr()->env.get();
+    program = blockExpr->getBlockExpr()->env;
     for(int i = 0; i < blockExpr->getBlockExpr()->stmts.size(); ++i) {
-      _visitStmt(blockExpr->getBlockExpr()->stmts[i].get());
+      _visitStmt(blockExpr->getBlockExpr()->stmts[i]);
     }
     program = prev;
     // A block that does not yield requires void type
@@ -388,96 +577,113 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
     return blockExpr;
   }
   // Check a for expression
-  Expr* visitForExpr(Expr* forExpr) override {
+  Expr* visitForExpr(Expr* forExpr) {
     // Visit all statements and body expression
     for (int i = 0; i < forExpr->getForExpr()->env->members.size(); ++i) {
       _visitStmt(forExpr->getForExpr()->env->getInOrder(i));
     }
     Environment* prev = program;
-    program = forExpr->getForExpr()->env.get();
-    forExpr->getForExpr()->body.reset(_visitExpr(forExpr->getForExpr()->body.release()));
+    program = forExpr->getForExpr()->env;
+    forExpr->getForExpr()->body = _visitExpr(forExpr->getForExpr()->body);
     forExpr->type = forExpr->getForExpr()->body->type;
     program = prev;
     return forExpr;
   }
   // Check while expression
-  Expr* visitWhileExpr(Expr* whileExpr) override {
-    _visitExpr(whileExpr->getWhileExpr()->cond.get());
+  Expr* visitWhileExpr(Expr* whileExpr) {
+    _visitExpr(whileExpr->getWhileExpr()->cond);
     // Condition must be bool
     if (whileExpr->getWhileExpr()->cond->type !=
         program->bottomTypes.boolType) {
-      std::cerr << "Invalid Type.";
+      *errors << "Invalid Type.";
       return nullptr;
     }
-   _visitExpr(whileExpr->getWhileExpr()->body.get());
+   _visitExpr(whileExpr->getWhileExpr()->body);
     whileExpr->type = whileExpr->getWhileExpr()->body->type;
     return whileExpr;
   }
   // Check get expression
-  Expr* visitGetExpr(Expr* getExpr) override {
-    // Ensure object element is defined
-    if (program->isRedeclaration(getExpr->getGetExpr()->name.name) !=
-        Environment::REDECLARATION_STATES::REDECLARATION) {
-      std::cerr << "Element not defined on object\n";
+  // Fields are found by name once, here - later passes use the index
+  Expr* visitGetExpr(Expr* getExpr) {
+    GetExpr* get = getExpr->getGetExpr();
+    Expr* checked = _visitExpr(get->expr);
+    if (!checked) {
+      *errors << "Element of an object that could not be checked\n";
       return nullptr;
     }
-    getExpr->type = program->getMember(getExpr->getGetExpr()->name.name)->type;
-    return getExpr;
+    get->expr = checked;
+    // Aliases point straight at their types once resolved
+    Type* object = get->expr->type.get();
+    if (object && object->isAliasType()) {
+      object = object->getAliasType()->type.get();
+    }
+    // Ensure object element is defined
+    if (object && object->isStructType()) {
+      std::vector<AliasType>& fields = object->getStructType()->types;
+      for (uint32_t field = 0; field < fields.size(); ++field) {
+        if (fields[field].alias == get->name.name) {
+          get->field = field;
+          getExpr->type = fields[field].type;
+          return getExpr;
+        }
+      }
+    }
+    *errors << "Element not defined on object\n";
+    return nullptr;
   }
   // Check call expression
-  Expr* visitCallExpr(Expr* callExpr) override {
-    callExpr->getCallExpr()->expr.reset(_visitExpr(callExpr->getCallExpr()->expr.release()));
+  Expr* visitCallExpr(Expr* callExpr) {
+    callExpr->getCallExpr()->expr = _visitExpr(callExpr->getCallExpr()->expr);
     if (callExpr->getCallExpr()->expr->isLiteralExpr() &&
-        callExpr->getCallExpr()->expr->getLiteralExpr()->name == "convert") {
+        callExpr->getCallExpr()->expr->getLiteralExpr()->name ==
+            convertName) {
+      // The parser keeps the target type on the first parameter
       if (callExpr->getCallExpr()->params.size() != 2 ||
-          !callExpr->getCallExpr()->params[0]->isLiteralExpr())
+          !callExpr->getCallExpr()->params[0]->type)
         return nullptr;
-      auto getType =
-          Parser(
-              Lexer(callExpr->getCallExpr()->params[0]->getLiteralExpr()->name),
-              program->generateInnerEnvironment().release())
-              .parse(Parser::parser::TYPE);
-      auto explicitType =
-          getType->getMember("$TypeCheckerName")->getTypeDef()->type;
-      callExpr->getCallExpr()->params[1].reset(_visitExpr(callExpr->getCallExpr()->params[1].release()));
-      if (callExpr->getCallExpr()->params[1]->type->isConvertible(
-              explicitType.get()) == Convert::FALSE)
+      auto explicitType = callExpr->getCallExpr()->params[0]->type;
+      callExpr->getCallExpr()->params[1] = _visitExpr(callExpr->getCallExpr()->params[1]);
+      if (program->types->isConvertible(
+          callExpr->getCallExpr()->params[1]->type.get(),
+          explicitType.get()) == Convert::FALSE)
         return nullptr;
-      auto storage = std::move(callExpr->getCallExpr()->params[1]);
-      auto typeConv = TypeConvExpr{false, storage->type, explicitType};
-      typeConv.expr = std::move(storage);
-      callExpr->innerExpr = std::move(typeConv);
+      auto storage = callExpr->getCallExpr()->params[1];
+      auto typeConv = arena->make<TypeConvExpr>(false, storage->type,
+                                                         explicitType);
+      typeConv->expr = storage;
+      callExpr->innerExpr = typeConv;
+      callExpr->type = explicitType;
       return callExpr;
     } else if (callExpr->getCallExpr()->expr->isLiteralExpr() &&
                callExpr->getCallExpr()->expr->getLiteralExpr()->name ==
-                   "printf") {
+                   printfName) {
       for (auto& param : callExpr->getCallExpr()->params) {
-        param.reset(_visitExpr(param.release()));
+        param = _visitExpr(param);
       }
       callExpr->type = program->bottomTypes.intType;
       return callExpr;
     } else if (callExpr->getCallExpr()->expr->type->isStructType()) {
       for (int i = 0; i < callExpr->getCallExpr()->params.size(); ++i) {
         // Visit each parameter
-        Expr* expr = callExpr->getCallExpr()->params[i].release();
+        Expr* expr = callExpr->getCallExpr()->params[i];
         expr = _visitExpr(expr);
-        callExpr->getCallExpr()->params[i].reset(expr);
-        switch (callExpr->getCallExpr()
-                    ->expr->type->getStructType()
-                    ->types[i]
-                    .type->isConvertible(expr->type.get())) {
+        callExpr->getCallExpr()->params[i] = expr;
+        Type* field =
+            callExpr->getCallExpr()->expr->type->getStructType()->types[i]
+                .type.get();
+        switch (program->types->isConvertible(field, expr->type.get())) {
           case Convert::SAME:
             break;
           case Convert::IMPLICIT: {
             std::shared_ptr<Type> newType = callExpr->getCallExpr()
                                                 ->expr->type->getFunctionType()
                                                 ->parameters[i];
-            auto typeConv =
-                std::make_unique<Expr>(expr->sourceLocation, newType,
-                                       TypeConvExpr{true, expr->type, newType});
+            auto typeConv = arena->make<Expr>(
+                expr->sourceLocation, newType,
+                arena->make<TypeConvExpr>(true, expr->type, newType));
             typeConv->getTypeConvExpr()->expr =
-                std::move(callExpr->getCallExpr()->params[i]);
-            callExpr->getCallExpr()->params[i] = std::move(typeConv);
+                callExpr->getCallExpr()->params[i];
+            callExpr->getCallExpr()->params[i] = typeConv;
             break;
           }
           case Convert::EXPLICIT:
@@ -491,30 +697,31 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
               ->expr->type->getFunctionType()
               ->parameters.size() != callExpr->getCallExpr()->params.size()) {
         // Ensure arity matches
-        std::cerr << "Arity doesn't match.";
+        *errors << "Arity doesn't match.";
         return nullptr;
       }
       for (int i = 0; i < callExpr->getCallExpr()->params.size(); ++i) {
-        Expr* expr = callExpr->getCallExpr()->params[i].release();
+        Expr* expr = callExpr->getCallExpr()->params[i];
         // Visit each parameter
         expr = _visitExpr(expr);
-        callExpr->getCallExpr()->params[i].reset(expr);
-        switch (callExpr->getCallExpr()
-                    ->expr->type->getFunctionType()
-                    ->parameters[i]
-                    ->isConvertible(expr->type.get())) {
+        callExpr->getCallExpr()->params[i] = expr;
+        Type* parameter = callExpr->getCallExpr()
+                              ->expr->type->getFunctionType()
+                              ->parameters[i]
+                              .get();
+        switch (program->types->isConvertible(parameter, expr->type.get())) {
           case Convert::SAME:
             break;
           case Convert::IMPLICIT: {
             std::shared_ptr<Type> newType = callExpr->getCallExpr()
                                                 ->expr->type->getFunctionType()
                                                 ->parameters[i];
-            auto typeConv =
-                std::make_unique<Expr>(expr->sourceLocation, newType,
-                                       TypeConvExpr{true, expr->type, newType});
+            auto typeConv = arena->make<Expr>(
+                expr->sourceLocation, newType,
+                arena->make<TypeConvExpr>(true, expr->type, newType));
             typeConv->getTypeConvExpr()->expr =
-                std::move(callExpr->getCallExpr()->params[i]);
-            callExpr->getCallExpr()->params[i] = std::move(typeConv);
+                callExpr->getCallExpr()->params[i];
+            callExpr->getCallExpr()->params[i] = typeConv;
             break;
           }
           case Convert::EXPLICIT:
@@ -527,11 +734,11 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
       return callExpr;
     } else if (callExpr->getCallExpr()->expr->type->isListType() &&
                callExpr->getCallExpr()->params.size() == 1) {
-      callExpr->getCallExpr()->params.front().reset(_visitExpr(callExpr->getCallExpr()->params.front().release()));
+      callExpr->getCallExpr()->params.front() = _visitExpr(callExpr->getCallExpr()->params.front());
       if (callExpr->getCallExpr()->params.front()->type !=
           program->bottomTypes.intType) {
         // Front parameter must be int
-        std::cerr << "Bad Index!";
+        *errors << "Bad Index!";
         return nullptr;
       }
       callExpr->type = callExpr->getCallExpr()->expr->type->getListType()->type;
@@ -541,6 +748,86 @@ struct TypeChecker : public ExprVisitor<Expr*>, StmtVisitor<void> {
   }
 
  private:
+  // Parallel checking only pays off with at least this many globals a thread
+  static constexpr uint32_t kMinParallelGlobals = 256;
+  // Most globals a thread takes at once when checking in parallel
+  static constexpr size_t kParallelBatch = 64;
+  // Return if a value of a struct type holds one of the same type - in its
+  // fields, or theirs, through aliases, optionals, tuples, sums and lists of
+  // a set size. Types wait on an explicit stack, and each struct is looked
+  // into once, so other cycles end
+  bool holdsItself(Type* structType) {
+    std::vector<Type*> pending;
+    std::vector<Type*> seen{structType};
+    auto fields = [&](Type* type) {
+      for (AliasType& field : type->getStructType()->types) {
+        if (field.type) pending.push_back(field.type.get());
+      }
+    };
+    fields(structType);
+    while (!pending.empty()) {
+      Type* type = pending.back();
+      pending.pop_back();
+      if (type == structType) return true;
+      if (type->isAliasType()) {
+        if (type->getAliasType()->type) {
+          pending.push_back(type->getAliasType()->type.get());
+        }
+      } else if (type->isOptionalType()) {
+        pending.push_back(type->getOptionalType()->optional.get());
+      } else if (type->isListType()) {
+        if (type->getListType()->size > 0) {
+          pending.push_back(type->getListType()->type.get());
+        }
+      } else if (type->isTupleType()) {
+        for (auto& part : type->getTupleType()->types) {
+          pending.push_back(part.get());
+        }
+      } else if (type->isSumType()) {
+        for (auto& part : type->getSumType()->types) {
+          pending.push_back(part.get());
+        }
+      } else if (type->isStructType() &&
+                 std::find(seen.begin(), seen.end(), type) == seen.end()) {
+        seen.push_back(type);
+        fields(type);
+      }
+    }
+    return false;
+  }
+  // Return the type a name stands for, reporting it and returning nullptr if
+  // it is not one. Types are all resolved by now and declared as globals,
+  // so none is made here, and a local of the same name does not hide one
+  std::shared_ptr<Type> typeNamed(Symbol name) {
+    if (std::shared_ptr<Type> bottom = program->bottomType(name)) {
+      return bottom;
+    }
+    Stmt* member = globals->find(name);
+    if (!member) {
+      *errors << "Unknown type " << name.str() << ".\n";
+      return nullptr;
+    }
+    return program->getType(name, member, *errors);
+  }
+  // Return the declaration the resolver bound a name to, nullptr if none
+  Stmt* declarationOf(const DeclarationRef& ref) {
+    if (!ref.resolved()) return nullptr;
+    if (ref.depth == 0) return &globals->members[ref.slot];
+    return (*frames[ref.depth - 1])[ref.slot];
+  }
   Environment* program;
+  // Outermost environment, where types and globals are declared
+  Environment* globals;
+  // Where conversions are made, and where diagnostics go
+  Arena* arena;
+  std::ostream* errors;
+  // Locals of each frame being checked, outermost first - the value of a
+  // global, field or method, then the functions in it
+  std::vector<std::vector<Stmt*>*> frames;
+  // Binary expressions visitBinaryExpr is inside of, outermost first
+  std::vector<Expr*> binaries;
+  // Names of the built in functions, interned once
+  Symbol convertName{"convert"};
+  Symbol printfName{"printf"};
 };
 #endif  // SENIORPROJECT_TYPE_CHECKER_H
@@ -0,0 +1,258 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#include "type_context.h"
+
+#include <algorithm>
+#include <utility>
+
+TypeContext::TypeContext() {
+  for (BottomType kind : {BottomType::INT, BottomType::CHAR, BottomType::BOOL,
+                          BottomType::FLOAT, BottomType::VOID,
+                          BottomType::SELF, BottomType::ERROR}) {
+    bottoms[static_cast<size_t>(kind)] =
+        intern(Key{InnerType{kind}.index(), static_cast<int>(kind), {}}, kind);
+  }
+}
+std::shared_ptr<Type> TypeContext::optional(std::shared_ptr<Type> type) {
+  Key key{InnerType{OptionalType{nullptr}}.index(), 0, {idOf(type)}};
+  return intern(std::move(key), OptionalType{std::move(type)});
+}
+std::shared_ptr<Type> TypeContext::list(int size, std::shared_ptr<Type> type) {
+  Key key{InnerType{ListType{0, nullptr}}.index(), size, {idOf(type)}};
+  return intern(std::move(key), ListType{size, std::move(type)});
+}
+std::shared_ptr<Type> TypeContext::tuple(
+    std::vector<std::shared_ptr<Type>> types) {
+  Key key{InnerType{TupleType{}}.index(), 0, {}};
+  for (const auto& type : types) key.parts.push_back(idOf(type));
+  return intern(std::move(key), TupleType{std::move(types)});
+}
+// Sums of sums are flattened, and types sorted by id with duplicates dropped,
+// so a set of types makes one sum whatever the order it is given in
+std::shared_ptr<Type> TypeContext::sum(
+    std::vector<std::shared_ptr<Type>> types) {
+  std::vector<std::shared_ptr<Type>> members;
+  members.reserve(types.size());
+  for (auto& type : types) {
+    if (type && type->isSumType()) {
+      const auto& inner = type->getSumType()->types;
+      members.insert(members.end(), inner.begin(), inner.end());
+    } else {
+      members.emplace_back(std::move(type));
+    }
+  }
+  std::sort(members.begin(), members.end(),
+            [](const std::shared_ptr<Type>& a, const std::shared_ptr<Type>& b) {
+              return idOf(a) < idOf(b);
+            });
+  members.erase(std::unique(members.begin(), members.end()), members.end());
+  Key key{InnerType{SumType{}}.index(), 0, {}};
+  for (const auto& member : members) key.parts.push_back(idOf(member));
+  return intern(std::move(key), SumType{std::move(members)});
+}
+// The return type is the first part
+std::shared_ptr<Type> TypeContext::function(
+    std::shared_ptr<Type> returner, std::vector<std::shared_ptr<Type>> params) {
+  Key key{InnerType{FunctionType{}}.index(), 0, {idOf(returner)}};
+  for (const auto& param : params) key.parts.push_back(idOf(param));
+  return intern(std::move(key),
+                FunctionType{std::move(returner), std::move(params)});
+}
+std::shared_ptr<Type> TypeContext::named(InnerType type) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return make(std::move(type));
+}
+std::shared_ptr<Type> TypeContext::unresolved(Symbol name) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ++unresolveds;
+  return make(AliasType(name, nullptr));
+}
+size_t TypeContext::unresolvedCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return unresolveds;
+}
+size_t TypeContext::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return count;
+}
+TypeContext::CacheStats TypeContext::cacheStats() const {
+  CacheStats total;
+  for (const CacheShard& shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    total.convertHits += shard.stats.convertHits;
+    total.convertMisses += shard.stats.convertMisses;
+    total.mergeHits += shard.stats.mergeHits;
+    total.mergeMisses += shard.stats.mergeMisses;
+  }
+  return total;
+}
+void TypeContext::reportCacheStats(std::ostream& out) const {
+  CacheStats counts = cacheStats();
+  out << "conversions: " << counts.convertHits << " hits, "
+      << counts.convertMisses << " misses\n";
+  out << "merges: " << counts.mergeHits << " hits, " << counts.mergeMisses
+      << " misses\n";
+}
+// Conversion of a to b, worked out once per pair
+Convert TypeContext::convertCached(Type* a, Type* b) {
+  uint64_t pair = pairOf(a, b);
+  CacheShard& shard = shardOf(pair);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.converts.find(pair);
+    if (found != shard.converts.end()) {
+      ++shard.stats.convertHits;
+      return found->second;
+    }
+    ++shard.stats.convertMisses;
+  }
+  Convert convert = a->isConvertible(b);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.converts.emplace(pair, convert);
+  return convert;
+}
+size_t TypeContext::KeyHash::operator()(const Key& key) const {
+  uint64_t hash = key.kind * 0x9E3779B97F4A7C15ull ^
+                  static_cast<uint32_t>(key.size);
+  for (uint32_t part : key.parts) {
+    hash = (hash ^ part) * 0x100000001B3ull;
+  }
+  return static_cast<size_t>(hash ^ (hash >> 29));
+}
+// Return the type with key
+std::shared_ptr<Type> TypeContext::intern(Key key, InnerType type) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = canonical.find(key);
+  if (found != canonical.end()) {
+    return std::shared_ptr<Type>(std::shared_ptr<Type>(), found->second);
+  }
+  std::shared_ptr<Type> made = make(std::move(type));
+  canonical.emplace(std::move(key), made.get());
+  return made;
+}
+// Make a type in the arena
+std::shared_ptr<Type> TypeContext::make(InnerType type) {
+  Type* made = arena.make<Type>(std::move(type),
+                                std::vector<std::shared_ptr<Impl>>{});
+  made->id = count++;
+  // Aliasing an empty shared_ptr - no control block, nothing to count
+  return std::shared_ptr<Type>(std::shared_ptr<Type>(), made);
+}
+// Merge two types, worked out once per pair
+std::shared_ptr<Type> TypeContext::merge(std::shared_ptr<Type> a,
+                                         std::shared_ptr<Type> b) {
+  if (!a) return b;
+  if (!b) return a;
+  if (a == b) return a;
+  uint64_t pair = pairOf(a.get(), b.get());
+  CacheShard& shard = shardOf(pair);
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.merges.find(pair);
+    if (found != shard.merges.end()) {
+      ++shard.stats.mergeHits;
+      return std::shared_ptr<Type>(std::shared_ptr<Type>(), found->second);
+    }
+    ++shard.stats.mergeMisses;
+  }
+  std::shared_ptr<Type> merged = mergeUncached(std::move(a), std::move(b));
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.merges.emplace(pair, merged.get());
+  return merged;
+}
+std::shared_ptr<Type> TypeContext::mergeUncached(std::shared_ptr<Type> a,
+                                                 std::shared_ptr<Type> b) {
+  // Return either if same types, the one convertible to if implicit conversion
+  // possible (a first)
+  if (convertsImplicitly(a.get(), b.get())) return a;
+  if (convertsImplicitly(b.get(), a.get())) return b;
+  if (a->isSumType() && b->isSumType()) {
+    // Both sum type - both are sorted by id, so the types they share are
+    // found in one pass. Of the rest, only those whose kinds can convert
+    // implicitly are compared pairwise
+    const auto& aTypes = a->getSumType()->types;
+    const auto& bTypes = b->getSumType()->types;
+    size_t aSize = aTypes.size();
+    size_t bSize = bTypes.size();
+    std::vector<bool> required(aSize + bSize, true);
+    for (size_t i = 0, j = 0; j < bSize; ++j) {
+      while (i < aSize && idOf(aTypes[i]) < idOf(bTypes[j])) ++i;
+      if (i < aSize && aTypes[i] == bTypes[j]) required[aSize + j] = false;
+    }
+    std::vector<int> groups(aSize + bSize);
+    uint32_t aGroups = 0;
+    uint32_t bGroups = 0;
+    for (size_t i = 0; i < aSize; ++i) {
+      groups[i] = groupOf(aTypes[i]);
+      aGroups |= 1u << groups[i];
+    }
+    for (size_t j = 0; j < bSize; ++j) {
+      groups[aSize + j] = groupOf(bTypes[j]);
+      bGroups |= 1u << groups[aSize + j];
+    }
+    // Members with a group the other sum has, or that convert with any
+    constexpr uint32_t kAny = 1u << Type::kAnyGroup;
+    std::vector<size_t> aCompared;
+    std::vector<size_t> bCompared;
+    for (size_t i = 0; i < aSize; ++i) {
+      if ((bGroups & (1u << groups[i] | kAny)) || groups[i] == Type::kAnyGroup)
+        aCompared.push_back(i);
+    }
+    for (size_t j = 0; j < bSize; ++j) {
+      if ((aGroups & (1u << groups[aSize + j] | kAny)) ||
+          groups[aSize + j] == Type::kAnyGroup)
+        bCompared.push_back(j);
+    }
+    auto mayConvert = [&](size_t i, size_t j) {
+      return groups[i] == groups[aSize + j] ||
+             groups[i] == Type::kAnyGroup ||
+             groups[aSize + j] == Type::kAnyGroup;
+    };
+    for (size_t j : bCompared) {
+      if (!required[aSize + j]) continue;
+      for (size_t i : aCompared) {
+        if (mayConvert(i, j) &&
+            convertsImplicitly(aTypes[i].get(), bTypes[j].get())) {
+          required[aSize + j] = false;
+          break;
+        }
+      }
+    }
+    for (size_t j : bCompared) {
+      if (!required[aSize + j]) continue;
+      for (size_t i : aCompared) {
+        if (!required[i]) continue;
+        if (mayConvert(i, j) &&
+            convertsImplicitly(bTypes[j].get(), aTypes[i].get())) {
+          required[i] = false;
+        }
+      }
+    }
+    std::vector<std::shared_ptr<Type>> types;
+    for (size_t i = 0; i < aSize; ++i) {
+      if (!required[i]) continue;
+      types.emplace_back(aTypes[i]);
+    }
+    for (size_t j = 0; j < bSize; ++j) {
+      if (!required[aSize + j]) continue;
+      types.emplace_back(bTypes[j]);
+    }
+    return sum(std::move(types));
+  } else if (a->isSumType()) {
+    // a only sum type
+    if (!a->getSumType()->types.empty()) return a;
+    return sum({b});
+  } else if (b->isSumType()) {
+    // b only sum type
+    if (!b->getSumType()->types.empty()) return b;
+    return sum({a});
+  } else {
+    // Optional if other is void, sum otherwise
+    if (a->isBottomType() && a->getBottomType() == BottomType::VOID) {
+      return optional(b);
+    }
+    if (b->isBottomType() && b->getBottomType() == BottomType::VOID) {
+      return optional(a);
+    }
+    return sum({a, b});
+  }
+}
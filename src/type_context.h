@@ -0,0 +1,132 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_TYPE_CONTEXT_H_
+#define INCLUDE_SRC_TYPE_CONTEXT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.h"
+#include "types.h"
+// Type context - the one copy of every type. Structural types (bottom,
+// optional, list, tuple, sum, function) are hash-consed from their parts, so
+// two of them are equal exactly when they are the same pointer (or id).
+// Alias, struct, and impl types are named, so each is its own. A name used
+// as a type before it is defined is an unresolved alias, until the type
+// resolver replaces it and completes the named types after parsing. Types
+// never change after that, so conversions and merges between them are cached
+// by id and never invalidated. Types live in the context's arena and are
+// handed out as shared_ptrs that own nothing, so copying one touches no
+// count. Thread safe
+class TypeContext {
+ public:
+  TypeContext();
+  TypeContext(const TypeContext&) = delete;
+  TypeContext& operator=(const TypeContext&) = delete;
+  // Return the canonical type of each kind
+  std::shared_ptr<Type> bottom(BottomType kind) const {
+    return bottoms[static_cast<size_t>(kind)];
+  }
+  std::shared_ptr<Type> optional(std::shared_ptr<Type> type);
+  std::shared_ptr<Type> list(int size, std::shared_ptr<Type> type);
+  std::shared_ptr<Type> tuple(std::vector<std::shared_ptr<Type>> types);
+  std::shared_ptr<Type> sum(std::vector<std::shared_ptr<Type>> types);
+  std::shared_ptr<Type> function(std::shared_ptr<Type> returner,
+                                 std::vector<std::shared_ptr<Type>> params);
+  // Return a new named type - an alias, struct, or impl
+  std::shared_ptr<Type> named(InnerType type);
+  // Return a new alias to name, which is not defined yet
+  std::shared_ptr<Type> unresolved(Symbol name);
+  // Return the number of those made
+  size_t unresolvedCount() const;
+  // Merge two types - either if the same, the one the other converts to
+  // implicitly (a first), else a sum or optional of both
+  std::shared_ptr<Type> merge(std::shared_ptr<Type> a,
+                              std::shared_ptr<Type> b);
+  // Return how a converts to b, as Type::isConvertible. Same types, even when
+  // both are missing, and bottom types are cheaper to work out than look up.
+  // A missing type converts to nothing
+  Convert isConvertible(Type* a, Type* b) {
+    if (a == b) return Convert::SAME;
+    if (!a || !b) return Convert::FALSE;
+    if (a->isBottomType()) return a->isConvertible(b);
+    return convertCached(a, b);
+  }
+  // Return the number of types made
+  size_t size() const;
+  // Hits and misses of the conversion and merge caches
+  struct CacheStats {
+    size_t convertHits = 0;
+    size_t convertMisses = 0;
+    size_t mergeHits = 0;
+    size_t mergeMisses = 0;
+  };
+  CacheStats cacheStats() const;
+  // Print the hits and misses of each cache
+  void reportCacheStats(std::ostream& out) const;
+
+ private:
+  // Structure of a type - its kind, list size, and the ids of its parts
+  struct Key {
+    size_t kind;
+    int size;
+    std::vector<uint32_t> parts;
+    bool operator==(const Key& other) const = default;
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+  static constexpr uint32_t kNoPart = UINT32_MAX;
+  static uint32_t idOf(const std::shared_ptr<Type>& type) {
+    return type ? type->id : kNoPart;
+  }
+  // Conversion group of a type, as Type::conversionGroup, missing ones in
+  // their own
+  static constexpr int kNoGroup = 31;
+  static int groupOf(const std::shared_ptr<Type>& type) {
+    return type ? type->conversionGroup() : kNoGroup;
+  }
+  // Key of an ordered pair of types in the caches
+  static uint64_t pairOf(const Type* a, const Type* b) {
+    return static_cast<uint64_t>(a->id) << 32 | b->id;
+  }
+  Convert convertCached(Type* a, Type* b);
+  std::shared_ptr<Type> mergeUncached(std::shared_ptr<Type> a,
+                                      std::shared_ptr<Type> b);
+  // Return whether a converts to b as SAME or IMPLICIT
+  bool convertsImplicitly(Type* a, Type* b) {
+    Convert convert = isConvertible(a, b);
+    return convert == Convert::SAME || convert == Convert::IMPLICIT;
+  }
+  // Return the type with key, made from type if there is none yet
+  std::shared_ptr<Type> intern(Key key, InnerType type);
+  // Make a type in the arena, with the next id; the mutex is held
+  std::shared_ptr<Type> make(InnerType type);
+  mutable std::mutex mutex;
+  Arena arena;
+  std::unordered_map<Key, Type*, KeyHash> canonical;
+  uint32_t count = 0;
+  size_t unresolveds = 0;
+  std::shared_ptr<Type> bottoms[7];
+  // Caches are split by pair into shards, so that checkers on several
+  // threads seldom wait on one lock. Each has its own lock, never held while
+  // a result is worked out
+  struct alignas(64) CacheShard {
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, Convert> converts;
+    std::unordered_map<uint64_t, Type*> merges;
+    CacheStats stats;
+  };
+  static constexpr int kCacheShardBits = 4;
+  static constexpr size_t kCacheShards = size_t{1} << kCacheShardBits;
+  CacheShard& shardOf(uint64_t pair) {
+    return shards[(pair * 0x9E3779B97F4A7C15ull) >> (64 - kCacheShardBits)];
+  }
+  CacheShard shards[kCacheShards];
+};
+
+#endif  // INCLUDE_SRC_TYPE_CONTEXT_H_
@@ -0,0 +1,239 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_SRC_TYPE_RESOLVER_H_
+#define INCLUDE_SRC_TYPE_RESOLVER_H_
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "environment.h"
+#include "expr.h"
+#include "stmt.h"
+#include "type_context.h"
+#include "types.h"
+
+// Type resolver - put every type in its final form, once, after parsing. A
+// name used as a type before it was defined becomes the type it names, each
+// alias points straight at a type that is not an alias, and the fields of
+// structs and impls are resolved the same way, so that later passes never
+// look through a chain of aliases or compare their names. Aliases that lead
+// back to themselves and unknown names are reported, and become the error
+// type. The tree is only walked when the parser
+// made unresolved aliases. Run again after the program is reparsed
+class TypeResolver : public ExprVisitor<TypeResolver, void>,
+                     public StmtVisitor<TypeResolver, void> {
+ public:
+  explicit TypeResolver(Environment* program) : program(program) {}
+  void resolve() {
+    if (program->types->unresolvedCount() == 0) {
+      // Only the named types themselves can need resolving
+      for (Stmt& global : program->members) {
+        if (global.isTypeDef() || global.isClassStmt() || global.isImplStmt()) {
+          resolveStmt(&global);
+        }
+      }
+      return;
+    }
+    for (Stmt& global : program->members) resolveStmt(&global);
+  }
+  void visitDeclarationStmt(Stmt* stmt) {
+    resolveExpr(stmt->getDeclarationStmt()->val);
+  }
+  void visitReturnStmt(Stmt* stmt) { resolveExpr(stmt->getReturnStmt()->val); }
+  void visitYieldStmt(Stmt* stmt) { resolveExpr(stmt->getYieldStmt()->val); }
+  void visitExprStmt(Stmt* stmt) { resolveExpr(stmt->getExprStmt()->val); }
+  void visitClassStmt(Stmt* stmt) {
+    ClassStmt* classStmt = stmt->getClassStmt();
+    classStmt->structType = finalOf(classStmt->structType);
+    for (Stmt& field : classStmt->parameters) resolveStmt(&field);
+  }
+  void visitImplStmt(Stmt* stmt) {
+    ImplStmt* implStmt = stmt->getImplStmt();
+    implStmt->implType = finalOf(implStmt->implType);
+    for (Stmt& method : implStmt->parameters) resolveStmt(&method);
+  }
+  void visitContinueStmt(Stmt*) {}
+  void visitTypeDef(Stmt* stmt) {
+    stmt->getTypeDef()->type = finalOf(stmt->getTypeDef()->type);
+  }
+  // Left operands of a long chain are walked in a loop, not recursively
+  void visitBinaryExpr(Expr* expr) {
+    size_t base = rights.size();
+    Expr* leftmost = expr;
+    for (; leftmost->isBinaryExpr();
+         leftmost = leftmost->getBinaryExpr()->left) {
+      leftmost->type = finalOf(leftmost->type);
+      rights.push_back(leftmost->getBinaryExpr()->right);
+    }
+    resolveExpr(leftmost);
+    while (rights.size() > base) {
+      Expr* right = rights.back();
+      rights.pop_back();
+      resolveExpr(right);
+    }
+  }
+  void visitPrefixExpr(Expr* expr) {
+    resolveExpr(expr->getPrefixExpr()->expr);
+  }
+  void visitFunctionExpr(Expr* expr) {
+    FunctionExpr* function = expr->getFunctionExpr();
+    function->returnType = finalOf(function->returnType);
+    for (Stmt& param : function->parameters->members) resolveStmt(&param);
+    resolveExpr(function->action);
+  }
+  void visitBlockExpr(Expr* expr) {
+    for (Stmt* stmt : expr->getBlockExpr()->stmts) resolveStmt(stmt);
+  }
+  void visitForExpr(Expr* expr) {
+    for (Stmt& var : expr->getForExpr()->env->members) resolveStmt(&var);
+    resolveExpr(expr->getForExpr()->body);
+  }
+  void visitWhileExpr(Expr* expr) {
+    resolveExpr(expr->getWhileExpr()->cond);
+    resolveExpr(expr->getWhileExpr()->body);
+  }
+  void visitIfExpr(Expr* expr) {
+    resolveExpr(expr->getIfExpr()->cond);
+    resolveExpr(expr->getIfExpr()->thenExpr);
+    resolveExpr(expr->getIfExpr()->elseExpr);
+  }
+  void visitMatchExpr(Expr* expr) {
+    resolveExpr(expr->getMatchExpr()->cond);
+    for (CaseExpr& caser : expr->getMatchExpr()->cases) {
+      caser.type = finalOf(caser.type);
+      if (caser.isTypeCond()) {
+        caser.cond = finalOf(caser.getTypeCase());
+      } else {
+        resolveExpr(caser.getExpr());
+      }
+      resolveExpr(caser.body);
+    }
+  }
+  void visitGetExpr(Expr* expr) { resolveExpr(expr->getGetExpr()->expr); }
+  void visitCallExpr(Expr* expr) {
+    resolveExpr(expr->getCallExpr()->expr);
+    for (Expr* param : expr->getCallExpr()->params) resolveExpr(param);
+  }
+  void visitTypeConvExpr(Expr* expr) {
+    TypeConvExpr* conv = expr->getTypeConvExpr();
+    conv->from = finalOf(conv->from);
+    conv->to = finalOf(conv->to);
+    resolveExpr(conv->expr);
+  }
+  void visitLiteralExpr(Expr*) {}
+  void visitIntExpr(Expr*) {}
+  void visitFloatExpr(Expr*) {}
+  void visitBoolExpr(Expr*) {}
+  void visitCharExpr(Expr*) {}
+  void visitStringExpr(Expr*) {}
+  void visitVoidExpr(Expr*) {}
+  void enterExprVisitor() {}
+  void exitExprVisitor() {}
+  void enterStmtVisitor() {}
+  void exitStmtVisitor() {}
+
+ private:
+  void resolveStmt(Stmt* stmt) {
+    stmt->type = finalOf(stmt->type);
+    _visitStmt(stmt);
+  }
+  void resolveExpr(Expr* expr) {
+    if (!expr) return;
+    expr->type = finalOf(expr->type);
+    _visitExpr(expr);
+  }
+  // Return the final form of type, worked out once per type
+  std::shared_ptr<Type> finalOf(const std::shared_ptr<Type>& type) {
+    if (!type || type->isBottomType()) return type;
+    if (type->id < finals.size() && finals[type->id]) return finals[type->id];
+    std::shared_ptr<Type> ans = make(type);
+    remember(type.get(), ans);
+    return ans;
+  }
+  // Structural types are made again from the final forms of their parts;
+  // named types stay themselves, with their parts resolved in place
+  std::shared_ptr<Type> make(const std::shared_ptr<Type>& type) {
+    TypeContext* types = program->types;
+    if (type->isOptionalType()) {
+      return types->optional(finalOf(type->getOptionalType()->optional));
+    } else if (type->isListType()) {
+      return types->list(type->getListType()->size,
+                         finalOf(type->getListType()->type));
+    } else if (type->isTupleType()) {
+      return types->tuple(finalsOf(type->getTupleType()->types));
+    } else if (type->isSumType()) {
+      return types->sum(finalsOf(type->getSumType()->types));
+    } else if (type->isFunctionType()) {
+      return types->function(finalOf(type->getFunctionType()->returner),
+                             finalsOf(type->getFunctionType()->parameters));
+    } else if (type->isStructType()) {
+      // Final before its fields, which may name it
+      remember(type.get(), type);
+      for (AliasType& field : type->getStructType()->types) {
+        field.type = finalOf(field.type);
+      }
+    } else if (type->isImpl()) {
+      remember(type.get(), type);
+      for (AliasType& include : type->getImpl()->includes) {
+        include.type = finalOf(include.type);
+      }
+    } else if (!type->getAliasType()->type) {
+      return named(type->getAliasType()->alias);
+    } else {
+      resolveAlias(type);
+    }
+    return type;
+  }
+  std::vector<std::shared_ptr<Type>> finalsOf(
+      const std::vector<std::shared_ptr<Type>>& parts) {
+    std::vector<std::shared_ptr<Type>> ans;
+    ans.reserve(parts.size());
+    for (const auto& part : parts) ans.emplace_back(finalOf(part));
+    return ans;
+  }
+  void remember(const Type* type, std::shared_ptr<Type> ans) {
+    if (type->id >= finals.size()) finals.resize(type->id + 1);
+    finals[type->id] = std::move(ans);
+  }
+  // Return the type name stands for, now that every global is defined
+  std::shared_ptr<Type> named(Symbol name) {
+    Stmt* member = program->getMember(name);
+    if (!member) {
+      std::cerr << "Unknown type " << name.str() << ".\n";
+      return program->types->bottom(BottomType::ERROR);
+    }
+    return finalOf(program->getType(name, member));
+  }
+  // Point an alias straight at the type at the end of its chain
+  void resolveAlias(const std::shared_ptr<Type>& type) {
+    if (resolving(type.get())) return;
+    aliases.push_back(type.get());
+    AliasType* alias = type->getAliasType();
+    std::shared_ptr<Type> target = finalOf(alias->type);
+    if (target && target->isAliasType()) {
+      if (resolving(target.get())) {
+        std::cerr << "Type " << alias->alias.str()
+                  << " is an alias of itself.\n";
+        target = program->types->bottom(BottomType::ERROR);
+      } else {
+        target = target->getAliasType()->type;
+      }
+    }
+    alias->type = target;
+    aliases.pop_back();
+  }
+  bool resolving(const Type* alias) const {
+    return std::find(aliases.begin(), aliases.end(), alias) != aliases.end();
+  }
+  Environment* program;
+  // Final form of each type made so far, by id
+  std::vector<std::shared_ptr<Type>> finals;
+  // Aliases being resolved, outermost first
+  std::vector<const Type*> aliases;
+  // Right operands visitBinaryExpr has yet to visit
+  std::vector<Expr*> rights;
+};
+
+#endif  // INCLUDE_SRC_TYPE_RESOLVER_H_
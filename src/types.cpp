@@ -1,46 +1,63 @@
 #include "types.h"
 
+#include <algorithm>
 #include <bit>
+#include <cstdint>
 #include <memory>
 #include <utility>
+// Id of a member of a sum, missing ones last
+static uint32_t idOf(const std::shared_ptr<Type>& type) {
+  return type ? type->id : UINT32_MAX;
+}
+bool SumType::contains(const Type* type) const {
+  auto found = std::lower_bound(
+      types.begin(), types.end(), type->id,
+      [](const std::shared_ptr<Type>& member, uint32_t id) {
+        return idOf(member) < id;
+      });
+  return found != types.end() && found->get() == type;
+}
 // Constructors
 OptionalType::OptionalType(std::shared_ptr<Type> type)
     : optional(std::move(type)) {}
+// Parts are canonical types in the type context, so copies share them
 OptionalType::OptionalType(const OptionalType& optional_type)
-    : optional(optional_type.optional ? optional_type.optional->clone()
-                                      : nullptr) {}
+    : optional(optional_type.optional) {}
 OptionalType::OptionalType(OptionalType&& optional_type) noexcept
-    : optional(optional_type.optional ? optional_type.optional->clone()
-                                      : nullptr) {}
+    : optional(std::move(optional_type.optional)) {}
 ListType::ListType(const ListType& list_type)
-    : size(list_type.size), type(list_type.type ? list_type.type->clone() : nullptr) {}
+    : size(list_type.size), type(list_type.type) {}
 ListType::ListType(ListType&& list_type) noexcept
     : size(list_type.size), type(std::move(list_type.type)) {}
 ListType::ListType(int size, std::shared_ptr<Type> type)
     : size(size), type(std::move(type)) {}
 FunctionType::FunctionType(const FunctionType& function_type)
-    : returner(function_type.returner ? function_type.returner->clone()
-                                      : nullptr),
+    : returner(function_type.returner),
       parameters(function_type.parameters) {}
 FunctionType::FunctionType(FunctionType&& function_type) noexcept
-    : returner(function_type.returner ? function_type.returner->clone()
-                                      : nullptr),
-      parameters(function_type.parameters) {}
+    : returner(std::move(function_type.returner)),
+      parameters(std::move(function_type.parameters)) {}
 AliasType::AliasType(const AliasType& alias_type)
     : alias(alias_type.alias),
-      type(alias_type.type ? alias_type.type->clone() : nullptr) {}
+      type(alias_type.type) {}
 AliasType::AliasType(AliasType&& alias_type) noexcept
-    : alias(alias_type.alias),
-      type(alias_type.type ? alias_type.type->clone() : nullptr) {}
+    : alias(alias_type.alias), type(std::move(alias_type.type)) {}
 Type::Type(const Type& type_t)
-    : type(type_t.type), interfaces(type_t.interfaces) {}
-Type::Type(const InnerType& type,
-           const std::vector<std::shared_ptr<Impl>>& interfaces)
-    : type(type), interfaces(interfaces) {}
+    : type(type_t.type), interfaces(type_t.interfaces), id(type_t.id) {}
+Type::Type(Type&& type_t) noexcept
+    : type(std::move(type_t.type)),
+      interfaces(std::move(type_t.interfaces)),
+      id(type_t.id) {}
+Type::Type(InnerType type, std::vector<std::shared_ptr<Impl>> interfaces)
+    : type(std::move(type)), interfaces(std::move(interfaces)) {}
 // Return if this type is convertible with another one
 Convert Type::isConvertible(Type* t) {
   // Same types
   if (this == t) return Convert::SAME;
+  // Error - already reported
+  if ((this->isBottomType() && this->getBottomType() == BottomType::ERROR) ||
+      (t->isBottomType() && t->getBottomType() == BottomType::ERROR))
+    return Convert::IMPLICIT;
   if (t->isBottomType() && t->getBottomType() == BottomType::VOID) {
     // Void
     if (this->isBottomType() && this->getBottomType() == BottomType::VOID)
@@ -105,6 +122,8 @@ Convert Type::isConvertible(Type* t) {
       case BottomType::SELF:
         if (t->isStructType()) return Convert::IMPLICIT;
         return Convert::FALSE;
+      case BottomType::ERROR:
+        return Convert::IMPLICIT;
     }
   } else if (this->isTupleType()) {
     // Tuple
@@ -160,10 +179,8 @@ Convert Type::isConvertible(Type* t) {
     }
     return expliciter ? Convert::EXPLICIT : Convert::SAME;
   } else if (this->isAliasType()) {
-    // Alias
+    // Alias - each is its own type, so others are never the same
     if (t->isAliasType()) {
-      if (this->getAliasType()->alias == t->getAliasType()->alias)
-        return Convert::SAME;
       auto ans = this->getAliasType()->type->isConvertible(
           t->getAliasType()->type.get());
       return ans == Convert::FALSE ? Convert::FALSE : Convert::EXPLICIT;
@@ -195,6 +212,7 @@ Convert Type::isConvertible(Type* t) {
   } else if (this->isSumType()) {
     // Sum
     if (!t->isSumType()) {
+      if (this->getSumType()->contains(t)) return Convert::IMPLICIT;
       Convert ans = Convert::FALSE;
       for (std::shared_ptr<Type> prod : this->getSumType()->types) {
         auto temp = prod->isConvertible(t);
@@ -208,7 +226,18 @@ Convert Type::isConvertible(Type* t) {
       if (this->getSumType()->types.size() == t->getSumType()->types.size())
         same = true;
       auto ans = Convert::SAME;
+      // Both are sorted by id, so the types they share are found in one pass
+      auto member = this->getSumType()->types.begin();
+      auto end = this->getSumType()->types.end();
       for (std::shared_ptr<Type> prod : t->getSumType()->types) {
+        while (member != end && idOf(*member) < idOf(prod)) ++member;
+        // Void is handled first, even when shared
+        if (member != end && *member == prod && prod &&
+            !(prod->isBottomType() &&
+              prod->getBottomType() == BottomType::VOID)) {
+          ans = Convert::IMPLICIT;
+          continue;
+        }
         auto temp = this->isConvertible(prod.get());
         if (temp == Convert::FALSE || temp == Convert::EXPLICIT)
           return Convert::FALSE;
@@ -222,85 +251,25 @@ Convert Type::isConvertible(Type* t) {
   return Convert::FALSE;
 }
 FunctionType::FunctionType() : returner(nullptr) {}
-// Merge two types
-std::shared_ptr<Type> Type::mergeTypes(std::shared_ptr<Type> a,
-                                       std::shared_ptr<Type> b) {
-  // Return either if same types, the one convertible to if implicit conversion
-  // possible (a first)
-  if (!a) return b;
-  if (!b) return a;
-  if (a == b) return a;
-  if (a->isConvertible(b.get()) == Convert::SAME ||
-      a->isConvertible(b.get()) == Convert::IMPLICIT)
-    return a;
-  if (b->isConvertible(a.get()) == Convert::SAME ||
-      b->isConvertible(a.get()) == Convert::IMPLICIT)
-    return b;
-  if (a->isSumType() && b->isSumType()) {
-    // Both sum type
-    size_t aSize = a->getSumType()->types.size();
-    size_t bSize = b->getSumType()->types.size();
-    std::vector<bool> required(aSize + bSize, true);
-    for (int i = 0; i < aSize; ++i) {
-      if (!required[i]) continue;
-      for (int j = 0; j < bSize; ++j) {
-        if (!required[aSize + j]) continue;
-        if (a->getSumType()->types[i]->isConvertible(
-                b->getSumType()->types[j].get()) == Convert::SAME ||
-            a->getSumType()->types[i]->isConvertible(
-                b->getSumType()->types[j].get()) == Convert::IMPLICIT) {
-          required[aSize + j] = false;
-        }
-      }
-    }
-    for (int j = 0; j < bSize; ++j) {
-      if (!required[aSize + j]) continue;
-      for (int i = 0; i < aSize; ++i) {
-        if (!required[i]) continue;
-        if (b->getSumType()->types[j]->isConvertible(
-                a->getSumType()->types[i].get()) == Convert::SAME ||
-            b->getSumType()->types[j]->isConvertible(
-                a->getSumType()->types[i].get()) == Convert::IMPLICIT) {
-          required[i] = false;
-        }
-      }
-    }
-    auto returnType = std::make_shared<Type>(Type{SumType{}, {}});
-    for (int i = 0; i < aSize; ++i) {
-      if (!required[i]) continue;
-      returnType->getSumType()->types.emplace_back(a->getSumType()->types[i]);
-    }
-    for (int j = 0; j < bSize; ++j) {
-      if (!required[aSize + j]) continue;
-      returnType->getSumType()->types.emplace_back(b->getSumType()->types[j]);
-    }
-    return returnType;
-  } else if (a->isSumType()) {
-    // a only sum type
-    for (auto& typ : a->getSumType()->types) {
-      if (typ->isConvertible(b.get()) == Convert::SAME ||
-          typ->isConvertible(b.get()) == Convert::IMPLICIT) {
-      }
-      return a;
-    }
-    return a->clone()->getSumType()->types.emplace_back(b);
-  } else if (b->isSumType()) {
-    // b only sum type
-    for (auto& typ : b->getSumType()->types) {
-      if (typ->isConvertible(a.get()) == Convert::SAME ||
-          typ->isConvertible(a.get()) == Convert::IMPLICIT) {
-      }
-      return b;
-    }
-    return b->clone()->getSumType()->types.emplace_back(a);
-  } else {
-    // Optional if other is void, sum otherwise
-    if (a->isBottomType() && a->getBottomType() == BottomType::VOID) {
-      return std::make_shared<Type>(Type{OptionalType(b), {}});
-    }
-    if (b->isBottomType() && b->getBottomType() == BottomType::VOID) {
-      return std::make_shared<Type>(Type{OptionalType(a), {}});
+int Type::conversionGroup() {
+  if (isOptionalType() || isAliasType()) return kAnyGroup;
+  if (isBottomType()) {
+    switch (getBottomType()) {
+      case BottomType::INT:
+      case BottomType::CHAR:
+      case BottomType::FLOAT:
+        return 1;
+      case BottomType::BOOL:
+        return 2;
+      case BottomType::SELF:
+        // Self converts to structs
+        return 3;
+      case BottomType::VOID:
+      case BottomType::ERROR:
+        return kAnyGroup;
     }
-    return std::make_shared<Type>(Type{SumType({a, b}), {}});
   }
+  if (isStructType()) return 3;
+  // The rest only convert with their own kind
+  return 4 + static_cast<int>(type.index());
 }
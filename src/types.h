@@ -2,15 +2,19 @@
 
 #ifndef SENIORPROJECT_TYPES_H
 #define SENIORPROJECT_TYPES_H
+#include <cstdint>
 #include <memory>
 #include <utility>
 #include <variant>
 #include <vector>
+
+#include "symbol.h"
 struct Type;
 // Conversion possibilities
 enum class Convert { SAME, IMPLICIT, EXPLICIT, FALSE };
-// Primary types
-enum class BottomType { INT, CHAR, BOOL, FLOAT, VOID, SELF };
+// Primary types. Error stands for a type that could not be resolved, and
+// converts to and from every type, so one bad name is reported only once
+enum class BottomType { INT, CHAR, BOOL, FLOAT, VOID, SELF, ERROR };
 // Optional type (may or may not have value)
 struct OptionalType {
   std::shared_ptr<Type> optional;
@@ -30,9 +34,12 @@ struct ListType {
   ListType(const ListType& list_type);
   ListType(ListType&& list_type) noexcept;
 };
-// Sum type - list of types
+// Sum type - list of types, as made by the type context: no sums, no
+// duplicates, and sorted by id
 struct SumType {
   std::vector<std::shared_ptr<Type>> types;
+  // Return if type is one of the types, by binary search
+  bool contains(const Type* type) const;
 };
 // Function type - parameters and return type
 struct FunctionType {
@@ -41,16 +48,16 @@ struct FunctionType {
   FunctionType();
   FunctionType(std::shared_ptr<Type> type,
                std::vector<std::shared_ptr<Type>> params)
-      : returner(type), parameters(params){};
+      : returner(std::move(type)), parameters(std::move(params)){};
   FunctionType(const FunctionType& function_type);
   FunctionType(FunctionType&& function_type) noexcept;
 };
 // Alias type - alias and type
 struct AliasType {
-  std::string alias;
+  Symbol alias;
   std::shared_ptr<Type> type;
-  AliasType(const std::string_view name) : alias(name){};
-  AliasType(const std::string_view name, std::shared_ptr<Type> t)
+  AliasType(Symbol name) : alias(name){};
+  AliasType(Symbol name, std::shared_ptr<Type> t)
       : alias(name), type(std::move(t)){};
   AliasType(const AliasType& alias_type);
   AliasType(AliasType&& alias_type) noexcept;
@@ -71,13 +78,11 @@ using InnerType =
 struct Type {
   InnerType type;
   std::vector<std::shared_ptr<Impl>> interfaces;
-  Type(const InnerType& type,
-       const std::vector<std::shared_ptr<Impl>>& interfaces);
+  // Id from the type context - structurally equal types share one
+  uint32_t id = 0;
+  Type(InnerType type, std::vector<std::shared_ptr<Impl>> interfaces);
   Type(const Type& type_t);
-  // Clone a pointer to this type
-  [[nodiscard]] std::shared_ptr<Type> clone() const {
-    return std::make_shared<Type>(type, interfaces);
-  }
+  Type(Type&& type_t) noexcept;
   // Check if type is of various types
   bool isBottomType() const {
     return std::visit(
@@ -155,7 +160,10 @@ struct Type {
   FunctionType* getFunctionType() { return &std::get<FunctionType>(type); };
   AliasType* getAliasType() { return &std::get<AliasType>(type); };
   Convert isConvertible(Type* t);
-  static std::shared_ptr<Type> mergeTypes(std::shared_ptr<Type> a,
-                                          std::shared_ptr<Type> b);
+  // Return the group of kinds this type converts implicitly with. Types in
+  // different groups never convert implicitly either way, unless one is in
+  // group 0 (optionals, aliases, void, and error), which may convert with any
+  static constexpr int kAnyGroup = 0;
+  int conversionGroup();
 };
 #endif  // SENIORPROJECT_TYPES_H
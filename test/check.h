@@ -0,0 +1,39 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+#ifndef INCLUDE_TEST_CHECK_H_
+#define INCLUDE_TEST_CHECK_H_
+#include <iostream>
+#include <string_view>
+
+#include "environment.h"
+#include "parser.h"
+#include "resolver.h"
+#include "type_checker.h"
+#include "type_resolver.h"
+
+// Shared pieces of the tests - each test exits with 1, saying which check
+// failed, if one does
+
+// Checks that have failed so far
+inline int failures = 0;
+// Report what did not hold, unless ok
+inline void check(bool ok, std::string_view what) {
+  if (ok) return;
+  std::cerr << "FAILED: " << what << "\n";
+  ++failures;
+}
+// Exit status of a test, from the checks that failed
+inline int checked() { return failures == 0 ? 0 : 1; }
+// Resolve the types and then the names of a parsed program
+inline Environment* resolve(Environment* program) {
+  TypeResolver{program}.resolve();
+  Resolver{program}.resolve();
+  return program;
+}
+// Parse, resolve and check a program; the result lives as long as parser
+inline Environment* compile(Parser& parser) {
+  Environment* program = resolve(parser.parse());
+  TypeChecker{program}.visit();
+  return program;
+}
+
+#endif  // INCLUDE_TEST_CHECK_H_
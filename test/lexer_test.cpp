@@ -0,0 +1,104 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+// Checks of the lexers
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "check.h"
+#include "lexer.h"
+#include "stream_lexer.h"
+#include "token.h"
+
+// Every kind of token, with strings that hold newlines and operators, and
+// operators that share their first characters
+static std::string sampleProgram(int copies) {
+  std::string program;
+  for (int i = 0; i < copies; ++i) {
+    std::string n = std::to_string(i);
+    program += "let value" + n + ": int = " + n + " << 2 >> 1 <= 3 >= 4;\n";
+    program += "const ratio" + n + " = 3.25 + " + n + ".5 * 1.0 / 2 % 7;\n";
+    program += "let text" + n + " = \"a string with\n let x = 1 -> 2;\n"
+               " in it\";\n";
+    program += "let chars" + n + " = ['a', '\\n', '\\x41', ''];\n";
+    program += "let f" + n + " = fn(a: int, b: optional[float]) -> bool {\n"
+               "  for i in 0..=10 { a = a + i; };\n"
+               "  while a != 0 && b == 1 || !(a ^ 1 & 2 | 3) { a = a - 1; };\n"
+               "  return a.b;\n"
+               "};\n";
+  }
+  return program;
+}
+// Lexing a file a chunk at a time gives the tokens lexing it whole does,
+// whatever chunk boundaries the tokens span
+static void streamMatchesTokenize() {
+  std::string program = sampleProgram(8);
+  Lexer whole{program};
+  std::vector<Token> tokens = whole.tokenize();
+  check(tokens.back().type == TOKEN_TYPE::FILE_END, "the sample lexes");
+  for (size_t chunkSize : {1, 2, 3, 7, 61}) {
+    std::FILE* file = std::tmpfile();
+    std::fwrite(program.data(), 1, program.size(), file);
+    std::fflush(file);
+    std::rewind(file);
+    StreamLexer stream{fileno(file), chunkSize};
+    bool same = true;
+    for (const Token& want : tokens) {
+      StreamToken got = stream.next();
+      same = got.token.type == want.type && got.token.offset == want.offset &&
+             got.text.size() == whole.sourceMap()->text(want).size();
+      if (!same) break;
+    }
+    std::fclose(file);
+    check(same, "tokens of chunks of " + std::to_string(chunkSize) +
+                    " bytes match");
+  }
+}
+// Lexing on several threads gives the tokens lexing on one does, with the
+// input split inside strings whose bodies look like code, one of them longer
+// than a token can say
+static void parallelMatchesTokenize() {
+  // Long strings are centred on the middle split, and the first of three;
+  // the other splits fall where they may
+  constexpr size_t kBytes = 9 << 20;
+  constexpr size_t kLongString = 70000;
+  std::string body;
+  while (body.size() < kLongString) body += "let y = 1 -> x;\n";
+  std::string program;
+  for (size_t split : {kBytes / 3, kBytes / 2}) {
+    while (program.size() < split - kLongString / 2) {
+      program += sampleProgram(1);
+    }
+    program += "let long = \"" + body + "\";\n";
+  }
+  while (program.size() < kBytes) program += sampleProgram(1);
+  Lexer serial{program};
+  std::vector<Token> tokens = serial.tokenize();
+  check(tokens.back().type == TOKEN_TYPE::FILE_END, "the input lexes");
+  check(std::any_of(tokens.begin(), tokens.end(),
+                    [](const Token& token) {
+                      return token.length == Token::kLongToken;
+                    }),
+        "the input has a long token");
+  for (unsigned threads : {2, 3, 8}) {
+    Lexer parallel{program};
+    std::vector<Token> got = parallel.tokenizeParallel(threads);
+    bool same = got.size() == tokens.size();
+    for (size_t i = 0; same && i < tokens.size(); ++i) {
+      same = got[i].type == tokens[i].type &&
+             got[i].offset == tokens[i].offset &&
+             got[i].length == tokens[i].length &&
+             parallel.sourceMap()->text(got[i]).size() ==
+                 serial.sourceMap()->text(tokens[i]).size();
+    }
+    check(same, "tokens lexed on " + std::to_string(threads) +
+                    " threads match");
+  }
+}
+
+int main() {
+  streamMatchesTokenize();
+  parallelMatchesTokenize();
+  return checked();
+}
@@ -0,0 +1,194 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+// Checks of the parser
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "check.h"
+#include "common.h"
+#include "environment.h"
+#include "expr.h"
+#include "lexer.h"
+#include "parser.h"
+#include "stmt.h"
+
+static void writeExpr(Expr* expr, std::ostream& out);
+static void writeEnvironment(Environment* env, std::ostream& out);
+// Write the position of every node under stmt, in tree order
+static void writeStmt(Stmt* stmt, std::ostream& out) {
+  out << stmt->location.line << ':' << stmt->location.character << ' ';
+  std::visit(
+      overloaded{[&](DeclarationStmt& declaration) {
+                   writeExpr(declaration.val, out);
+                 },
+                 [&](ReturnStmt& ret) { writeExpr(ret.val, out); },
+                 [&](YieldStmt& yield) { writeExpr(yield.val, out); },
+                 [&](ExprStmt& exprStmt) { writeExpr(exprStmt.val, out); },
+                 [&](ClassStmt& classStmt) {
+                   for (Stmt& member : classStmt.parameters) {
+                     writeStmt(&member, out);
+                   }
+                 },
+                 [&](ImplStmt& impl) {
+                   for (Stmt& member : impl.parameters) writeStmt(&member, out);
+                 },
+                 [](auto&) {}},
+      stmt->stmt);
+}
+static void writeEnvironment(Environment* env, std::ostream& out) {
+  if (!env) return;
+  for (Stmt& member : env->members) writeStmt(&member, out);
+}
+static void writeExpr(Expr* expr, std::ostream& out) {
+  if (!expr) return;
+  out << expr->sourceLocation.line << ':' << expr->sourceLocation.character
+      << ' ';
+  std::visit(
+      overloaded{[&](BinaryExpr& binary) {
+                   writeExpr(binary.left, out);
+                   writeExpr(binary.right, out);
+                 },
+                 [&](PrefixExpr& prefix) { writeExpr(prefix.expr, out); },
+                 [&](FunctionExpr* function) {
+                   writeEnvironment(function->parameters, out);
+                   writeExpr(function->action, out);
+                 },
+                 [&](TypeConvExpr* conv) { writeExpr(conv->expr, out); },
+                 [&](MatchExpr* match) {
+                   writeExpr(match->cond, out);
+                   for (CaseExpr& matchCase : match->cases) {
+                     if (matchCase.isExprCond()) {
+                       writeExpr(matchCase.getExpr(), out);
+                     }
+                     writeExpr(matchCase.body, out);
+                   }
+                 },
+                 [&](IfExpr& ifExpr) {
+                   writeExpr(ifExpr.cond, out);
+                   writeExpr(ifExpr.thenExpr, out);
+                   writeExpr(ifExpr.elseExpr, out);
+                 },
+                 [&](BlockExpr* block) {
+                   for (Stmt* inner : block->stmts) writeStmt(inner, out);
+                   writeEnvironment(block->env, out);
+                 },
+                 [&](ForExpr& forExpr) {
+                   writeEnvironment(forExpr.env, out);
+                   writeExpr(forExpr.body, out);
+                 },
+                 [&](WhileExpr& whileExpr) {
+                   writeExpr(whileExpr.cond, out);
+                   writeExpr(whileExpr.body, out);
+                 },
+                 [&](GetExpr& get) { writeExpr(get.expr, out); },
+                 [&](CallExpr* call) {
+                   writeExpr(call->expr, out);
+                   for (Expr* param : call->params) writeExpr(param, out);
+                 },
+                 [](auto&) {}},
+      expr->innerExpr);
+}
+static std::string positions(Environment* program) {
+  std::ostringstream out;
+  for (size_t i = 0; i < program->members.size(); ++i) {
+    writeStmt(program->getInOrder(i), out);
+    out << '\n';
+  }
+  return out.str();
+}
+// Globals kept by reparse() after lines are added above them are where a
+// fresh parse puts them, down to loop iterables and the bodies of type cases
+static void reparseMovesKeptGlobals() {
+  std::string source =
+      "let a: int = 1;\n"
+      "let s: int | float = 1;\n"
+      "let f = fn(x: int) -> int {\n"
+      "  for i in 0..\n"
+      "      10 { x = x + i; };\n"
+      "  yield match s {\n"
+      "    case (int, float) -> 1\n"
+      "    case optional[int] -> x };\n"
+      "};\n";
+  Parser parser{Lexer{source}};
+  parser.parse();
+  parser.reparse(0, 0, "\n\n");
+  Environment* kept = parser.settleLines();
+  std::string edited = "\n\n" + source;
+  Parser fresh{Lexer{edited}};
+  check(positions(kept) == positions(fresh.parse()),
+        "reparse moves kept globals to where a parse puts them");
+}
+
+// Whether reparse() of each edit, one after another, leaves the program a
+// parse of the edited input gives
+struct Edit {
+  size_t offset;
+  size_t removed;
+  std::string_view text;
+};
+static bool reparseMatchesParse(std::string source,
+                                std::initializer_list<Edit> edits) {
+  Parser parser{Lexer{source}};
+  parser.parse();
+  for (const Edit& edit : edits) {
+    parser.reparse(edit.offset, edit.removed, edit.text);
+    source.replace(edit.offset, edit.removed, edit.text);
+  }
+  Environment* kept = parser.settleLines();
+  Parser fresh{Lexer{source}};
+  Environment* parsed = fresh.parse();
+  return kept->members.size() == parsed->members.size() &&
+         positions(kept) == positions(parsed);
+}
+// Globals for the edits below - a class, which is only kept if no global
+// before it changes kind, and lets around a function
+static const std::string kGlobals =
+    "let a: int = 1;\n"
+    "class Pair { let first: int; let second: int; };\n"
+    "let f = fn(x: int) -> int {\n"
+    "  x = x + a;\n"
+    "  return x;\n"
+    "};\n"
+    "let g: int = 2;\n";
+// Lines added inside a global and a value changed, so that it is parsed
+// again and the globals after it are kept, then the lines taken out again
+static void reparseEditsInsideGlobal() {
+  size_t plus = kGlobals.find("+ a");
+  check(reparseMatchesParse(kGlobals, {{plus, 1, "+\n\n"}}),
+        "lines added inside a global move the globals after it");
+  check(reparseMatchesParse(kGlobals, {{plus + 2, 1, "12"}}),
+        "a value changed inside a global is parsed again");
+  check(reparseMatchesParse(kGlobals, {{plus, 1, "+\n\n"}, {plus, 3, "+"}}),
+        "lines added and taken out again leave the globals after them");
+  check(reparseMatchesParse(kGlobals, {{0, 0, "\n"}, {plus + 3, 1, "12"}}),
+        "a global parsed again drops the lines it was yet to move by");
+}
+// A global deleted, which renames the globals after it
+static void reparseDeletesGlobal() {
+  size_t g = kGlobals.find("let g");
+  check(reparseMatchesParse(kGlobals, {{0, kGlobals.find("class"), ""}}),
+        "deleting the first global parses the rest again");
+  check(reparseMatchesParse(kGlobals, {{g, kGlobals.size() - g, ""}}),
+        "deleting the last global drops it");
+}
+// A class changed, or a global added, parses everything after it again;
+// globals before it keep the lines they were yet to move by
+static void reparseFallsBackToEnd() {
+  size_t second = kGlobals.find("let second");
+  size_t g = kGlobals.find("let g");
+  check(reparseMatchesParse(kGlobals, {{second + 12, 3, "float"}}),
+        "a changed class parses the globals after it again");
+  check(reparseMatchesParse(kGlobals,
+                            {{0, 0, "\n"}, {g + 1, 0, "let h: int = 3;\n"}}),
+        "an added global parses the globals after it again");
+}
+
+int main() {
+  reparseMovesKeptGlobals();
+  reparseEditsInsideGlobal();
+  reparseDeletesGlobal();
+  reparseFallsBackToEnd();
+  return checked();
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+// Checks of the resolver
+#include <string_view>
+
+#include "check.h"
+#include "environment.h"
+#include "expr.h"
+#include "lexer.h"
+#include "parser.h"
+#include "stmt.h"
+
+// A let in a block in a global's value is bound in the global's own frame,
+// shadowing a global of the same name, which the global does not then use
+static void blockLetShadowsGlobal() {
+  std::string_view source =
+      "let y: int = 3;\n"
+      "let g = { let y: float = 1.0; yield y; };\n";
+  Parser parser{Lexer{source}};
+  Environment* program = compile(parser);
+  DeclarationStmt* g = program->find(Symbol{"g"})->getDeclarationStmt();
+  Expr* y = g->val->getBlockExpr()->stmts[1]->getYieldStmt()->val;
+  const DeclarationRef& ref = y->getLiteralExpr()->declaration;
+  check(ref.depth == 1 && ref.slot == 0, "block let binds in the global");
+  Stmt* let = g->val->getBlockExpr()->stmts[0];
+  check(g->locals.size() == 1 && g->locals[0] == let,
+        "global keeps its block let");
+  check(y->type == program->bottomTypes.floatType,
+        "block let is typed as declared");
+  uint32_t slot = program->slotOf(Symbol{"g"});
+  check(program->usesBegin[slot] == program->usesBegin[slot + 1],
+        "shadowed global is not used");
+}
+// A global named in a block, with no let of its name, is still the global
+static void blockUsesGlobal() {
+  std::string_view source =
+      "let y: float = 3.0;\n"
+      "let g = { let x: int = 1; yield y; };\n";
+  Parser parser{Lexer{source}};
+  Environment* program = compile(parser);
+  DeclarationStmt* g = program->find(Symbol{"g"})->getDeclarationStmt();
+  Expr* y = g->val->getBlockExpr()->stmts[1]->getYieldStmt()->val;
+  const DeclarationRef& ref = y->getLiteralExpr()->declaration;
+  check(ref.depth == 0 && ref.slot == program->slotOf(Symbol{"y"}),
+        "global named in a block binds to the global");
+  check(y->type == program->bottomTypes.floatType, "global keeps its type");
+}
+
+int main() {
+  blockLetShadowsGlobal();
+  blockUsesGlobal();
+  return checked();
+}
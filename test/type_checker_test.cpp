@@ -0,0 +1,182 @@
+// Copyright (c) 2024 Compile Collective. All Rights Reserved.
+// Checks of the type checker
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "check.h"
+#include "environment.h"
+#include "expr.h"
+#include "lexer.h"
+#include "parser.h"
+#include "stmt.h"
+#include "type_context.h"
+#include "types.h"
+
+// Cases of a sum type name types, whatever locals are in scope, and naming
+// an unknown one makes no new type to resolve after resolution
+static void sumCasesNameTypes() {
+  std::string_view source =
+      "class Shape { let sides: int; };\n"
+      "let s: int | float = 1;\n"
+      "let f = fn(Shape: int) -> int match s {\n"
+      "  case int -> 1 case Shape -> 2 case Missing -> 3 };\n";
+  Parser parser{Lexer{source}};
+  Environment* program = resolve(parser.parse());
+  size_t unresolved = program->types->unresolvedCount();
+  TypeChecker{program}.visit();
+  check(program->types->unresolvedCount() == unresolved,
+        "no type is left to resolve after checking");
+  Expr* match = program->find(Symbol{"f"})
+                    ->getDeclarationStmt()
+                    ->val->getFunctionExpr()
+                    ->action;
+  std::vector<CaseExpr>& cases = match->getMatchExpr()->cases;
+  check(cases[1].isTypeCond() &&
+            cases[1].getTypeCase() ==
+                program->find(Symbol{"Shape"})->getClassStmt()->structType,
+        "a parameter does not hide the type of its name");
+  check(cases[2].isExprCond(), "an unknown type is not made a type");
+}
+// An object that could not be checked has no fields, rather than crashing
+// the checker, and a class that holds itself by value is checked in finite
+// time
+static void badObjectsAreReported() {
+  std::string_view source =
+      "class Node { let value: int; let next: Node; };\n"
+      "let s: int | float = 1;\n"
+      "let x = (match s { case Missing -> 1 }).value;\n";
+  Parser parser{Lexer{source}};
+  Environment* program = compile(parser);
+  GetExpr* get =
+      program->find(Symbol{"x"})->getDeclarationStmt()->val->getGetExpr();
+  check(get->expr && get->field == GetExpr::kNoField,
+        "field of an unchecked object is not resolved");
+}
+// Aliases of themselves and unknown names become the error type, which
+// converts to and from every type, rather than missing types
+static void badTypesAreErrors() {
+  std::string_view source =
+      "type A = B;\n"
+      "type B = A;\n"
+      "let x: A = 1;\n"
+      "let f = fn(a: Missing) -> int 1;\n"
+      "let y = f(1);\n";
+  Parser parser{Lexer{source}};
+  Environment* program = compile(parser);
+  std::shared_ptr<Type> error = program->types->bottom(BottomType::ERROR);
+  check(program->find(Symbol{"B"})->getTypeDef()->type->getAliasType()->type ==
+            error,
+        "an alias of itself is the error type");
+  FunctionExpr* f =
+      program->find(Symbol{"f"})->getDeclarationStmt()->val->getFunctionExpr();
+  check(f->parameters->getInOrder(0)->type == error,
+        "an unknown type is the error type");
+  check(program->find(Symbol{"y"})->type == program->bottomTypes.intType,
+        "a call with an error parameter is checked");
+}
+// Conversions between the same sums are worked out once, then looked up
+static void sumConversionsAreCached() {
+  std::string_view source =
+      "let s: int | float = 1;\n"
+      "let a: int | float | bool = s;\n"
+      "let b: int | float | bool = s;\n"
+      "let c: int | float | bool = s;\n";
+  Parser parser{Lexer{source}};
+  Environment* program = compile(parser);
+  TypeContext::CacheStats stats = program->types->cacheStats();
+  check(stats.convertMisses >= 1, "the first conversion is worked out");
+  check(stats.convertHits >= 2, "the conversions after it are looked up");
+}
+// Text of a type, the same for equal types made in different contexts
+static std::string describe(Type* type) {
+  if (!type) return "none";
+  std::string text;
+  auto parts = [&text](const std::vector<std::shared_ptr<Type>>& types,
+                       bool sorted) {
+    std::vector<std::string> described;
+    for (const auto& part : types) described.push_back(describe(part.get()));
+    if (sorted) std::sort(described.begin(), described.end());
+    for (const auto& part : described) text += part + ",";
+  };
+  if (type->isBottomType()) {
+    text = "bottom" + std::to_string(static_cast<int>(type->getBottomType()));
+  } else if (type->isOptionalType()) {
+    text = "optional[" + describe(type->getOptionalType()->optional.get()) + "]";
+  } else if (type->isListType()) {
+    text = "list" + std::to_string(type->getListType()->size) + "[" +
+           describe(type->getListType()->type.get()) + "]";
+  } else if (type->isTupleType()) {
+    text = "(";
+    parts(type->getTupleType()->types, false);
+    text += ")";
+  } else if (type->isSumType()) {
+    // Members are in order of id, which differs between contexts
+    text = "|";
+    parts(type->getSumType()->types, true);
+    text += "|";
+  } else if (type->isFunctionType()) {
+    text = "fn(";
+    parts(type->getFunctionType()->parameters, false);
+    text += ")->" + describe(type->getFunctionType()->returner.get());
+  } else if (type->isAliasType()) {
+    text = std::string{type->getAliasType()->alias.str()};
+  } else {
+    text = "named" + std::to_string(type->id);
+  }
+  return text;
+}
+// Checking in parallel reports what checking in order does, in the same
+// order, and gives every global the same type - with calls to earlier and
+// later globals, redefinitions, mismatches, and classes reported by name
+// throughout
+static void parallelMatchesSerial() {
+  constexpr int kFunctions = 2048;
+  std::string source;
+  for (int i = 0; i < kFunctions; ++i) {
+    std::string n = std::to_string(i);
+    std::string later = std::to_string((i + 7) % kFunctions);
+    std::string earlier = std::to_string((i + kFunctions - 3) % kFunctions);
+    source += "let f" + n + ": fn(int) -> int = fn(a: int) -> int f" + later +
+              "(a) + f" + earlier + "(a);\n";
+    source += "let v" + n + " = f" + n + "(" + n + ");\n";
+    if (i % 64 == 0) source += "let v" + n + " = 2.5;\n";
+    if (i % 7 == 0) source += "let w" + n + ": bool = v" + n + ";\n";
+    if (i % 97 == 0) {
+      source += "class Loop" + n + " { let next: Loop" + n + "; };\n";
+    }
+    if (i % 11 == 0) {
+      source += "let s" + n + ": int | float = v" + n + ";\n";
+      source += "let t" + n + ": int | float | bool = s" + n + ";\n";
+    }
+  }
+  std::ostringstream serialErrors;
+  Parser serialParser{Lexer{source}};
+  Environment* serial = resolve(serialParser.parse());
+  TypeChecker{serial, serialErrors}.visit();
+  std::ostringstream parallelErrors;
+  Parser parallelParser{Lexer{source}};
+  Environment* parallel = resolve(parallelParser.parse());
+  TypeChecker{parallel, parallelErrors}.visitParallel(4);
+  check(!serialErrors.view().empty(), "the module has diagnostics");
+  check(parallelErrors.view() == serialErrors.view(),
+        "diagnostics are the same, in the same order");
+  bool same = serial->members.size() == parallel->members.size();
+  for (size_t slot = 0; same && slot < serial->members.size(); ++slot) {
+    same = describe(serial->members[slot].type.get()) ==
+           describe(parallel->members[slot].type.get());
+  }
+  check(same, "every global has the same type");
+}
+
+int main() {
+  sumCasesNameTypes();
+  badObjectsAreReported();
+  badTypesAreErrors();
+  sumConversionsAreCached();
+  parallelMatchesSerial();
+  return checked();
+}